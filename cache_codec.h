@@ -0,0 +1,416 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file cache_codec.h
+ * \brief lightweight array codecs for the compressed row block cache
+ */
+#ifndef DMLC_DATA_CACHE_CODEC_H_
+#define DMLC_DATA_CACHE_CODEC_H_
+
+#include <dmlc/base.h>
+#include <dmlc/logging.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace dmlc {
+namespace data {
+namespace codec {
+/*!
+ * \brief highest codec level.
+ *  0 stores arrays raw, 1 adds delta + varint for integer arrays and
+ *  dictionaries for low cardinality arrays, 2 also tries byte shuffle +
+ *  run length coding and keeps whichever encoding is smallest.
+ */
+const int kMaxLevel = 2;
+/*! \brief largest dictionary, codes are stored in 8 or 16 bits */
+const size_t kMaxDictSize = 1 << 16;
+/*! \brief encoded arrays are padded to a multiple of this */
+const size_t kArrayAlign = 8;
+/*! \brief encoding of an array */
+enum ArrayMethod {
+  kRaw = 0,
+  kDeltaVarint = 1,
+  kDict8 = 2,
+  kDict16 = 3,
+  kShuffleRLE = 4
+};
+/*! \brief header of an encoded array */
+struct ArrayHeader {
+  /*! \brief number of elements */
+  uint64_t count;
+  /*! \brief bytes of the encoded data, excluding padding */
+  uint64_t nbytes;
+  /*! \brief ArrayMethod */
+  uint32_t method;
+  /*! \brief sizeof the element type */
+  uint32_t type_size;
+};
+
+/*! \brief append v as LEB128 varint */
+inline void PutVarint(uint64_t v, std::string *out) {
+  while (v >= 0x80) {
+    out->push_back(static_cast<char>(v | 0x80));
+    v >>= 7;
+  }
+  out->push_back(static_cast<char>(v));
+}
+/*! \brief read a LEB128 varint, return false on truncated input */
+inline bool GetVarint(const char **p, const char *end, uint64_t *out) {
+  uint64_t v = 0;
+  for (int shift = 0; shift < 64 && *p != end; shift += 7) {
+    uint8_t b = static_cast<uint8_t>(*(*p)++);
+    v |= static_cast<uint64_t>(b & 0x7f) << shift;
+    if (b < 0x80) {
+      *out = v;
+      return true;
+    }
+  }
+  return false;
+}
+/*! \brief zigzag coded difference of consecutive values, then varint */
+template<typename T>
+inline void EncodeDeltaVarint(const T *data, size_t n, std::string *out) {
+  uint64_t prev = 0;
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t v = static_cast<uint64_t>(data[i]);
+    uint64_t delta = v - prev;
+    PutVarint((delta << 1) ^ (0 - (delta >> 63)), out);
+    prev = v;
+  }
+}
+template<typename T>
+inline bool DecodeDeltaVarint(const char *p, const char *end, T *data, size_t n) {
+  uint64_t prev = 0;
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t z;
+    if (!GetVarint(&p, end, &z)) return false;
+    prev += (z >> 1) ^ (0 - (z & 1));
+    data[i] = static_cast<T>(prev);
+  }
+  return p == end;
+}
+/*!
+ * \brief run length coding of bytes.
+ *  A control byte c < 128 is followed by c + 1 literal bytes,
+ *  c >= 128 is followed by one byte repeated c - 125 times.
+ */
+inline void PackRuns(const uint8_t *s, size_t n, std::string *out) {
+  size_t i = 0;
+  while (i < n) {
+    size_t run = 1;
+    while (i + run < n && run < 130 && s[i + run] == s[i]) ++run;
+    if (run >= 3) {
+      out->push_back(static_cast<char>(run + 125));
+      out->push_back(static_cast<char>(s[i]));
+      i += run;
+      continue;
+    }
+    size_t j = i;
+    while (j < n && j - i < 128) {
+      if (j + 2 < n && s[j] == s[j + 1] && s[j] == s[j + 2]) break;
+      ++j;
+    }
+    out->push_back(static_cast<char>(j - i - 1));
+    out->append(reinterpret_cast<const char*>(s + i), j - i);
+    i = j;
+  }
+}
+inline bool UnpackRuns(const char *p, const char *end, uint8_t *out, size_t n) {
+  uint8_t *oend = out + n;
+  while (p != end) {
+    size_t c = static_cast<uint8_t>(*p++);
+    if (c < 128) {
+      size_t len = c + 1;
+      if (static_cast<size_t>(end - p) < len || static_cast<size_t>(oend - out) < len) {
+        return false;
+      }
+      std::memcpy(out, p, len);
+      p += len;
+      out += len;
+    } else {
+      size_t len = c - 125;
+      if (p == end || static_cast<size_t>(oend - out) < len) return false;
+      std::memset(out, static_cast<uint8_t>(*p++), len);
+      out += len;
+    }
+  }
+  return out == oend;
+}
+/*! \brief group the k-th bytes of all elements together, then run length code */
+inline void EncodeShuffleRLE(const char *data, size_t n, size_t type_size,
+                             std::vector<uint8_t> *planes, std::string *out) {
+  planes->resize(n * type_size);
+  for (size_t b = 0; b < type_size; ++b) {
+    uint8_t *plane = BeginPtr(*planes) + b * n;
+    for (size_t i = 0; i < n; ++i) {
+      plane[i] = static_cast<uint8_t>(data[i * type_size + b]);
+    }
+  }
+  PackRuns(BeginPtr(*planes), planes->size(), out);
+}
+inline bool DecodeShuffleRLE(const char *p, const char *end, char *data,
+                             size_t n, size_t type_size) {
+  std::vector<uint8_t> planes(n * type_size);
+  if (!UnpackRuns(p, end, BeginPtr(planes), planes.size())) return false;
+  for (size_t b = 0; b < type_size; ++b) {
+    const uint8_t *plane = BeginPtr(planes) + b * n;
+    for (size_t i = 0; i < n; ++i) {
+      data[i * type_size + b] = static_cast<char>(plane[i]);
+    }
+  }
+  return true;
+}
+template<typename T>
+inline bool DecodeDict(const char *p, const char *end, T *data, size_t n, bool wide) {
+  uint64_t ndict;
+  if (!GetVarint(&p, end, &ndict) || ndict == 0 || ndict > kMaxDictSize) return false;
+  size_t dict_bytes = static_cast<size_t>(ndict) * sizeof(T);
+  size_t code_bytes = n * (wide ? sizeof(uint16_t) : 1);
+  if (static_cast<size_t>(end - p) != dict_bytes + code_bytes) return false;
+  std::vector<T> dict(static_cast<size_t>(ndict));
+  std::memcpy(BeginPtr(dict), p, dict_bytes);
+  p += dict_bytes;
+  for (size_t i = 0; i < n; ++i) {
+    size_t code;
+    if (wide) {
+      uint16_t c;
+      std::memcpy(&c, p + i * sizeof(c), sizeof(c));
+      code = c;
+    } else {
+      code = static_cast<uint8_t>(p[i]);
+    }
+    if (code >= dict.size()) return false;
+    data[i] = dict[code];
+  }
+  return true;
+}
+
+/*!
+ * \brief encodes arrays, choosing the smallest encoding allowed by the
+ *  codec level. Keeps the buffers of the trial encodings and of the
+ *  dictionary between arrays, so that an encoder that is kept for every
+ *  block of a cache only allocates while the buffers grow.
+ */
+class ArrayEncoder {
+ public:
+  /*! \param level codec level, see kMaxLevel */
+  explicit ArrayEncoder(int level) : level_(level) {}
+  /*! \return the codec level */
+  inline int level(void) const {
+    return level_;
+  }
+  /*!
+   * \brief append the encoded array to out
+   * \param vec the array
+   * \param out output buffer
+   */
+  template<typename T>
+  inline void Encode(const std::vector<T> &vec, std::string *out);
+
+ private:
+  /*!
+   * \brief arrays longer than this decide on the dictionary from this many
+   *  evenly spaced elements first
+   */
+  static const size_t kDictSample = 4096;
+  /*! \brief insert key into table_, return its code */
+  inline uint32_t Insert(uint64_t key, size_t mask) {
+    size_t pos = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while (table_[pos] != 0) {
+      if (dict_[table_[pos] - 1] == key) return table_[pos] - 1;
+      pos = (pos + 1) & mask;
+    }
+    dict_.push_back(key);
+    table_[pos] = static_cast<uint32_t>(dict_.size());
+    return table_[pos] - 1;
+  }
+  /*! \brief empty the dictionary, the table gets at least 2 * n slots, return the mask */
+  inline size_t ResetDict(size_t n) {
+    size_t size = 16;
+    while (size < 2 * n) size <<= 1;
+    if (table_.size() < size) table_.resize(size);
+    std::fill(table_.begin(), table_.begin() + size, 0);
+    dict_.clear();
+    return size - 1;
+  }
+  /*!
+   * \brief dictionary coding: varint dictionary size, the raw dictionary,
+   *  then one 8 or 16 bit code per element
+   * \return the method used, kRaw if there are, or the sample suggests
+   *  there are, too many distinct values
+   */
+  template<typename T>
+  inline ArrayMethod EncodeDict(const T *data, size_t n, std::string *out);
+  /*! \brief codec level */
+  int level_;
+  /*! \brief smallest encoding so far and the current trial */
+  std::string best_, trial_;
+  /*! \brief open addressing table of dictionary codes + 1, 0 is empty */
+  std::vector<uint32_t> table_;
+  /*! \brief bit patterns of the dictionary entries, in code order */
+  std::vector<uint64_t> dict_;
+  /*! \brief code of every element */
+  std::vector<uint16_t> seq_;
+  /*! \brief byte planes of the shuffle encoding */
+  std::vector<uint8_t> planes_;
+};
+
+template<typename T>
+inline ArrayMethod ArrayEncoder::EncodeDict(const T *data, size_t n, std::string *out) {
+  // compare bit patterns so that every float, including nan, has a code
+  typedef typename std::conditional<sizeof(T) == 8, uint64_t,
+      typename std::conditional<sizeof(T) == 4, uint32_t,
+      typename std::conditional<sizeof(T) == 2, uint16_t, uint8_t>::type>::type>::type Key;
+  static_assert(sizeof(T) == sizeof(Key), "dictionary needs 1, 2, 4 or 8 byte elements");
+  Key key;
+  if (n > 4 * kDictSample) {
+    // under 1/16 repeats among the sample means over about 30000 distinct
+    // values, where 16 bit codes rarely beat the other encodings
+    size_t mask = this->ResetDict(kDictSample);
+    for (size_t i = 0; i < kDictSample; ++i) {
+      std::memcpy(&key, data + i * (n / kDictSample), sizeof(key));
+      this->Insert(key, mask);
+    }
+    if (dict_.size() > kDictSample - kDictSample / 16) return kRaw;
+  }
+  size_t mask = this->ResetDict(std::min(n, kMaxDictSize));
+  seq_.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    std::memcpy(&key, data + i, sizeof(key));
+    uint32_t code = this->Insert(key, mask);
+    if (code == kMaxDictSize) return kRaw;
+    seq_[i] = static_cast<uint16_t>(code);
+  }
+  PutVarint(dict_.size(), out);
+  size_t pos = out->size();
+  bool wide = dict_.size() > 256;
+  out->resize(pos + dict_.size() * sizeof(Key) + n * (wide ? sizeof(uint16_t) : 1));
+  char *dst = &(*out)[pos];
+  for (size_t i = 0; i < dict_.size(); ++i, dst += sizeof(Key)) {
+    key = static_cast<Key>(dict_[i]);
+    std::memcpy(dst, &key, sizeof(key));
+  }
+  if (wide) {
+    std::memcpy(dst, BeginPtr(seq_), n * sizeof(uint16_t));
+    return kDict16;
+  }
+  for (size_t i = 0; i < n; ++i) dst[i] = static_cast<char>(seq_[i]);
+  return kDict8;
+}
+
+template<typename T>
+inline void ArrayEncoder::Encode(const std::vector<T> &vec, std::string *out) {
+  ArrayHeader header;
+  header.count = vec.size();
+  header.nbytes = vec.size() * sizeof(T);
+  header.method = kRaw;
+  header.type_size = sizeof(T);
+  if (level_ > 0 && vec.size() != 0) {
+    // no trial takes more than twice the raw bytes
+    trial_.reserve(2 * header.nbytes + 16);
+    best_.reserve(2 * header.nbytes + 16);
+    if (std::is_integral<T>::value) {
+      trial_.clear();
+      EncodeDeltaVarint(BeginPtr(vec), vec.size(), &trial_);
+      if (trial_.size() < header.nbytes) {
+        header.method = kDeltaVarint;
+        header.nbytes = trial_.size();
+        best_.swap(trial_);
+      }
+    }
+    // the codes alone take a byte per element, so offsets and sorted
+    // indices that delta code to about a byte never use the dictionary
+    if (header.nbytes > vec.size()) {
+      trial_.clear();
+      ArrayMethod method = this->EncodeDict(BeginPtr(vec), vec.size(), &trial_);
+      if (method != kRaw && trial_.size() < header.nbytes) {
+        header.method = method;
+        header.nbytes = trial_.size();
+        best_.swap(trial_);
+      }
+    }
+    if (level_ > 1) {
+      trial_.clear();
+      EncodeShuffleRLE(reinterpret_cast<const char*>(BeginPtr(vec)),
+                       vec.size(), sizeof(T), &planes_, &trial_);
+      if (trial_.size() < header.nbytes) {
+        header.method = kShuffleRLE;
+        header.nbytes = trial_.size();
+        best_.swap(trial_);
+      }
+    }
+  }
+  out->append(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (header.method == kRaw) {
+    out->append(reinterpret_cast<const char*>(BeginPtr(vec)), vec.size() * sizeof(T));
+  } else {
+    out->append(best_.data(), header.nbytes);
+  }
+  out->append((kArrayAlign - header.nbytes % kArrayAlign) % kArrayAlign, '\0');
+}
+/*!
+ * \return the most elements of type_size bytes that nbytes of method can
+ *  decode to, so that a corrupted count is caught before it is allocated
+ */
+inline uint64_t MaxDecodedCount(uint32_t method, uint64_t nbytes, size_t type_size) {
+  switch (method) {
+    case kRaw: return nbytes / type_size;
+    // at least one byte per element
+    case kDeltaVarint:
+    case kDict8: return nbytes;
+    case kDict16: return nbytes / 2;
+    // a run of two bytes expands to at most 130
+    case kShuffleRLE: return nbytes / 2 * 130 / type_size;
+    default: return 0;
+  }
+}
+/*!
+ * \brief decode an array written by ArrayEncoder::Encode
+ * \param p the read position, advanced past the array
+ * \param end end of the buffer
+ * \param vec the decoded array
+ * \return false if the data is corrupted
+ */
+template<typename T>
+inline bool DecodeArray(const char **p, const char *end, std::vector<T> *vec) {
+  ArrayHeader header;
+  if (static_cast<size_t>(end - *p) < sizeof(header)) return false;
+  std::memcpy(&header, *p, sizeof(header));
+  *p += sizeof(header);
+  size_t padded = header.nbytes + (kArrayAlign - header.nbytes % kArrayAlign) % kArrayAlign;
+  if (header.type_size != sizeof(T) ||
+      header.nbytes > static_cast<size_t>(end - *p) ||
+      padded > static_cast<size_t>(end - *p) ||
+      header.count > MaxDecodedCount(header.method, header.nbytes, sizeof(T))) {
+    return false;
+  }
+  const char *data = *p;
+  const char *dend = data + header.nbytes;
+  *p += padded;
+  size_t n = static_cast<size_t>(header.count);
+  vec->resize(n);
+  switch (header.method) {
+    case kRaw:
+      if (header.nbytes != n * sizeof(T)) return false;
+      if (n != 0) std::memcpy(BeginPtr(*vec), data, header.nbytes);
+      return true;
+    case kDeltaVarint:
+      return std::is_integral<T>::value &&
+          DecodeDeltaVarint(data, dend, BeginPtr(*vec), n);
+    case kDict8:
+    case kDict16:
+      return DecodeDict(data, dend, BeginPtr(*vec), n, header.method == kDict16);
+    case kShuffleRLE:
+      return DecodeShuffleRLE(data, dend, reinterpret_cast<char*>(BeginPtr(*vec)),
+                              n, sizeof(T));
+    default:
+      return false;
+  }
+}
+}  // namespace codec
+}  // namespace data
+}  // namespace dmlc
+#endif  // DMLC_DATA_CACHE_CODEC_H_
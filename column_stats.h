@@ -0,0 +1,430 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file column_stats.h
+ * \brief streaming per column statistics of row blocks, collected by the
+ *  parse workers of the text parsers, and the parser and iterator adaptors
+ *  that collect or forward them while the data is read
+ */
+#ifndef DMLC_DATA_COLUMN_STATS_H_
+#define DMLC_DATA_COLUMN_STATS_H_
+
+#include <dmlc/base.h>
+#include <dmlc/data.h>
+#include <dmlc/logging.h>
+#include <dmlc/omp.h>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace dmlc {
+namespace data {
+/*!
+ * \brief accumulates DataStats over row blocks. Add may be called by
+ *  several threads at once, e.g. the parse workers of a text parser: every
+ *  call takes an accumulator of its own from a pool, so the rows are added
+ *  without a lock. Get merges the accumulators that hold rows not merged
+ *  yet by column id, so the cost of a merge is the number of columns the
+ *  new rows touched, not the number of columns seen so far.
+ * \tparam IndexType type of index in RowBlock
+ * \tparam DType type of label and value in RowBlock
+ */
+template<typename IndexType, typename DType = real_t>
+class ColumnStatsCollector {
+ public:
+  ColumnStatsCollector(void) : epoch_(0) {}
+  /*! \brief forget every row added so far */
+  inline void Clear(void);
+  /*!
+   * \brief add the rows [begin, end) of block, thread safe
+   * \param block the block
+   * \param begin the first row to add
+   * \param end the row after the last row to add
+   */
+  inline void Add(const RowBlock<IndexType, DType> &block, size_t begin, size_t end);
+  /*! \brief add the rows of block, thread safe */
+  inline void Add(const RowBlock<IndexType, DType> &block) {
+    this->Add(block, 0, block.size);
+  }
+  /*! \brief add the rows of block, split over OpenMP threads if it is large */
+  inline void ParallelAdd(const RowBlock<IndexType, DType> &block);
+  /*!
+   * \return statistics of the rows added since Clear, not counting the
+   *  calls of Add still running. Valid until the next Get or Clear.
+   */
+  inline const DataStats &Get(void);
+
+ private:
+  /*! \brief statistics of one column */
+  struct Entry {
+    uint64_t nnz;
+    double min, max, sum, sumsq;
+    inline void Reset(void) {
+      nnz = 0;
+      min = std::numeric_limits<double>::infinity();
+      max = -std::numeric_limits<double>::infinity();
+      sum = sumsq = 0.0;
+    }
+    inline void Push(double v) {
+      nnz += 1;
+      min = std::min(min, v);
+      max = std::max(max, v);
+      sum += v;
+      sumsq += v * v;
+    }
+  };
+  /*!
+   * \brief columns below are always accumulated in an array, and columns
+   *  below kDenseRatio times the number of columns seen also are; the
+   *  others are in a hash map, so that hashed or sparse 64 bit ids take
+   *  memory per column seen
+   */
+  static const size_t kDenseColumn = 1 << 16;
+  /*! \brief see kDenseColumn */
+  static const size_t kDenseRatio = 8;
+  /*! \brief blocks with fewer entries are added by one thread in ParallelAdd */
+  static const size_t kMinThreadEntries = 1 << 16;
+  /*! \brief statistics of the columns of one section, since the last merge */
+  struct Section {
+    /*! \brief the first columns, grown by doubling, see kDenseColumn */
+    std::vector<Entry> dense;
+    /*! \brief the columns of dense with entries */
+    std::vector<size_t> touched;
+    /*! \brief the other columns, a column may also be in dense if dense grew */
+    std::unordered_map<uint64_t, Entry> sparse;
+    inline void Push(uint64_t j, double v) {
+      if (j >= dense.size()) {
+        const uint64_t limit = std::max<uint64_t>(
+            static_cast<uint64_t>(kDenseColumn), kDenseRatio * (touched.size() + sparse.size()));
+        if (j < limit) {
+          Entry e;
+          e.Reset();
+          dense.resize(std::min<uint64_t>(std::max<uint64_t>(j + 1, dense.size() * 2), limit), e);
+        }
+      }
+      if (j < dense.size()) {
+        Entry &e = dense[j];
+        if (e.nnz == 0) touched.push_back(j);
+        e.Push(v);
+      } else {
+        std::pair<typename std::unordered_map<uint64_t, Entry>::iterator, bool> it =
+            sparse.emplace(j, Entry());
+        if (it.second) it.first->second.Reset();
+        it.first->second.Push(v);
+      }
+    }
+    inline void Reset(void) {
+      for (size_t j : touched) dense[j].Reset();
+      touched.clear();
+      sparse.clear();
+    }
+  };
+  /*! \brief an accumulator, section 0 is the rows, then the extras */
+  struct Local {
+    uint64_t num_row = 0;
+    std::vector<Section> section;
+    /*! \brief the epoch_ the rows were added in */
+    uint64_t epoch = 0;
+    inline void Reset(void) {
+      num_row = 0;
+      for (size_t s = 0; s < section.size(); ++s) section[s].Reset();
+    }
+  };
+  /*! \brief guards the pool and the merged statistics */
+  std::mutex mutex_;
+  /*! \brief all accumulators */
+  std::vector<std::unique_ptr<Local> > local_;
+  /*! \brief accumulators not used by a call of Add */
+  std::vector<Local*> free_;
+  /*! \brief number of Clear calls, rows of an older epoch are dropped */
+  uint64_t epoch_;
+  /*! \brief merged statistics */
+  DataStats stats_;
+  /*! \brief position of every column in the merged statistics, per section */
+  std::vector<std::unordered_map<uint64_t, size_t> > pos_;
+  /*! \brief add the entries [begin, end) of the rows */
+  template<typename I>
+  inline static void AddRows(const I *index, const DType *value,
+                             size_t begin, size_t end, Section *out) {
+    if (value == NULL) {
+      for (size_t i = begin; i < end; ++i) out->Push(static_cast<uint64_t>(index[i]), 1.0);
+    } else {
+      for (size_t i = begin; i < end; ++i) {
+        out->Push(static_cast<uint64_t>(index[i]), static_cast<double>(value[i]));
+      }
+    }
+  }
+  /*! \brief merge entry e of column j into out, whose columns are at pos */
+  inline static void MergeEntry(uint64_t j, const Entry &e, ColumnStats *out,
+                                std::unordered_map<uint64_t, size_t> *pos) {
+    std::pair<std::unordered_map<uint64_t, size_t>::iterator, bool> it =
+        pos->emplace(j, out->index.size());
+    if (it.second) {
+      out->index.push_back(j);
+      out->nnz.push_back(e.nnz);
+      out->min.push_back(e.min);
+      out->max.push_back(e.max);
+      out->sum.push_back(e.sum);
+      out->sumsq.push_back(e.sumsq);
+    } else {
+      const size_t c = it.first->second;
+      out->nnz[c] += e.nnz;
+      out->min[c] = std::min(out->min[c], e.min);
+      out->max[c] = std::max(out->max[c], e.max);
+      out->sum[c] += e.sum;
+      out->sumsq[c] += e.sumsq;
+    }
+  }
+  /*! \brief merge the rows of local into stats_ and reset it, with mutex_ held */
+  inline void Merge(Local *local);
+};
+
+template<typename IndexType, typename DType>
+inline void ColumnStatsCollector<IndexType, DType>::Clear(void) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++epoch_;
+  // the accumulators in use are reset when they come back
+  for (Local *local : free_) {
+    local->Reset();
+    local->epoch = epoch_;
+  }
+  stats_ = DataStats();
+  pos_.clear();
+}
+
+template<typename IndexType, typename DType>
+inline void ColumnStatsCollector<IndexType, DType>::
+Add(const RowBlock<IndexType, DType> &block, size_t begin, size_t end) {
+  if (begin == end) return;
+  Local *local;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.size() != 0) {
+      local = free_.back();
+      free_.pop_back();
+    } else {
+      local_.emplace_back(new Local());
+      local = local_.back().get();
+      local->epoch = epoch_;
+    }
+  }
+  if (local->section.size() < block.extra.size() + 1) {
+    local->section.resize(block.extra.size() + 1);
+  }
+  local->num_row += end - begin;
+  const size_t ebegin = block.offset[begin], eend = block.offset[end];
+  if (block.index16 != NULL) {
+    AddRows(block.index16, block.value, ebegin, eend, &local->section[0]);
+  } else if (block.index32 != NULL) {
+    AddRows(block.index32, block.value, ebegin, eend, &local->section[0]);
+  } else {
+    AddRows(block.index, block.value, ebegin, eend, &local->section[0]);
+  }
+  for (size_t s = 0; s < block.extra.size(); ++s) {
+    const UnitBlock<IndexType> &unit = block.extra[s];
+    Section *out = &local->section[s + 1];
+    for (size_t r = begin; r < end; ++r) {
+      UnitData<IndexType> row = unit[r];
+      for (size_t k = 0; k < row.length; ++k) {
+        out->Push(static_cast<uint64_t>(row.get_index(k)),
+                  static_cast<double>(row.get_value(k)));
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (local->epoch != epoch_) {
+    // Clear was called while the rows were added
+    local->Reset();
+    local->epoch = epoch_;
+  }
+  free_.push_back(local);
+}
+
+template<typename IndexType, typename DType>
+inline void ColumnStatsCollector<IndexType, DType>::
+ParallelAdd(const RowBlock<IndexType, DType> &block) {
+  const size_t nnz = block.offset[block.size] - block.offset[0];
+  const size_t useful = std::max<size_t>(nnz / kMinThreadEntries, 1);
+  const int nthread = static_cast<int>(std::min(
+      static_cast<size_t>(std::max(omp_get_max_threads(), 1)), useful));
+  if (nthread == 1) {
+    this->Add(block);
+    return;
+  }
+  #pragma omp parallel num_threads(nthread)
+  {
+    const size_t tid = static_cast<size_t>(omp_get_thread_num());
+    const size_t nthr = static_cast<size_t>(omp_get_num_threads());
+    const size_t lo = block.size / nthr * tid + std::min(tid, block.size % nthr);
+    const size_t hi = lo + block.size / nthr + (tid < block.size % nthr ? 1 : 0);
+    this->Add(block, lo, hi);
+  }
+}
+
+template<typename IndexType, typename DType>
+inline const DataStats &ColumnStatsCollector<IndexType, DType>::Get(void) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Local *local : free_) this->Merge(local);
+  return stats_;
+}
+
+template<typename IndexType, typename DType>
+inline void ColumnStatsCollector<IndexType, DType>::Merge(Local *local) {
+  stats_.num_row += local->num_row;
+  const size_t nsection = local->section.size();
+  if (stats_.extra.size() + 1 < nsection) stats_.extra.resize(nsection - 1);
+  if (pos_.size() < nsection) pos_.resize(nsection);
+  for (size_t s = 0; s < nsection; ++s) {
+    ColumnStats *out = s == 0 ? &stats_.column : &stats_.extra[s - 1];
+    const Section &in = local->section[s];
+    for (size_t j : in.touched) {
+      MergeEntry(j, in.dense[j], out, &pos_[s]);
+    }
+    for (const auto &kv : in.sparse) {
+      MergeEntry(kv.first, kv.second, out, &pos_[s]);
+    }
+  }
+  local->Reset();
+}
+
+/*!
+ * \brief collects the column statistics of the blocks of the wrapped
+ *  parser as they are returned, for the parsers that do not collect them
+ *  in their parse workers, see Parser::Stats
+ * \tparam IndexType type of index in RowBlock
+ * \tparam DType type of label and value in RowBlock
+ */
+template <typename IndexType, typename DType = real_t>
+class StatsParser : public Parser<IndexType, DType> {
+ public:
+  /*!
+   * \brief constructor
+   * \param base the parser to wrap, owned by this parser
+   */
+  explicit StatsParser(Parser<IndexType, DType> *base)
+      : base_(base) {}
+  virtual ~StatsParser(void) {
+    delete base_;
+  }
+  virtual void BeforeFirst(void) {
+    base_->BeforeFirst();
+    stats_.Clear();
+  }
+  virtual bool Next(void) {
+    if (!base_->Next()) return false;
+    stats_.ParallelAdd(base_->Value());
+    return true;
+  }
+  virtual const RowBlock<IndexType, DType> &Value(void) const {
+    return base_->Value();
+  }
+  virtual size_t BytesRead(void) const {
+    return base_->BytesRead();
+  }
+  virtual const DataStats *Stats(void) {
+    return &stats_.Get();
+  }
+
+ private:
+  /*! \brief the wrapped parser */
+  Parser<IndexType, DType> *base_;
+  /*! \brief statistics of the current pass */
+  ColumnStatsCollector<IndexType, DType> stats_;
+};
+
+/*!
+ * \brief collects the column statistics of the blocks of the wrapped
+ *  iterator during its first pass, see RowBlockIter::Stats
+ * \tparam IndexType type of index in RowBlock
+ * \tparam DType type of label and value in RowBlock
+ */
+template <typename IndexType, typename DType = real_t>
+class StatsRowIter : public RowBlockIter<IndexType, DType> {
+ public:
+  /*!
+   * \brief constructor
+   * \param base the iterator to wrap, owned by this iterator
+   */
+  explicit StatsRowIter(RowBlockIter<IndexType, DType> *base)
+      : base_(base), done_(false) {}
+  virtual ~StatsRowIter(void) {
+    delete base_;
+  }
+  virtual void BeforeFirst(void) {
+    base_->BeforeFirst();
+    // a first pass that was not finished starts over
+    if (!done_) stats_.Clear();
+  }
+  virtual bool Next(void) {
+    if (!base_->Next()) {
+      done_ = true;
+      return false;
+    }
+    if (!done_) stats_.ParallelAdd(base_->Value());
+    return true;
+  }
+  virtual const RowBlock<IndexType, DType> &Value(void) const {
+    return base_->Value();
+  }
+  virtual size_t NumCol(void) const {
+    return base_->NumCol();
+  }
+  virtual const DataStats *Stats(void) {
+    return &stats_.Get();
+  }
+
+ private:
+  /*! \brief the wrapped iterator */
+  RowBlockIter<IndexType, DType> *base_;
+  /*! \brief whether the first pass is over */
+  bool done_;
+  /*! \brief statistics of the first pass */
+  ColumnStatsCollector<IndexType, DType> stats_;
+};
+
+/*!
+ * \brief a ThreadedParser with the Stats of the parser it runs, which
+ *  collects them in its parse workers; ThreadedParser does not forward them
+ * \tparam IndexType type of index in RowBlock
+ * \tparam DType type of label and value in RowBlock
+ */
+template <typename IndexType, typename DType = real_t>
+class ThreadedStatsParser : public Parser<IndexType, DType> {
+ public:
+  /*!
+   * \brief constructor
+   * \param threaded the threaded parser, owned by this parser
+   * \param base the parser run by threaded, owned by threaded
+   */
+  ThreadedStatsParser(Parser<IndexType, DType> *threaded, Parser<IndexType, DType> *base)
+      : threaded_(threaded), base_(base) {}
+  virtual ~ThreadedStatsParser(void) {
+    delete threaded_;
+  }
+  virtual void BeforeFirst(void) {
+    threaded_->BeforeFirst();
+  }
+  virtual bool Next(void) {
+    return threaded_->Next();
+  }
+  virtual const RowBlock<IndexType, DType> &Value(void) const {
+    return threaded_->Value();
+  }
+  virtual size_t BytesRead(void) const {
+    return threaded_->BytesRead();
+  }
+  virtual const DataStats *Stats(void) {
+    return base_->Stats();
+  }
+
+ private:
+  /*! \brief the threaded parser */
+  Parser<IndexType, DType> *threaded_;
+  /*! \brief the parser run by threaded_ */
+  Parser<IndexType, DType> *base_;
+};
+}  // namespace data
+}  // namespace dmlc
+#endif  // DMLC_DATA_COLUMN_STATS_H_
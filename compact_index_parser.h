@@ -0,0 +1,182 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file compact_index_parser.h
+ * \brief parser adaptor that stores the feature indices of every block
+ *  in the narrowest width that holds them
+ */
+#ifndef DMLC_DATA_COMPACT_INDEX_PARSER_H_
+#define DMLC_DATA_COMPACT_INDEX_PARSER_H_
+
+#include <dmlc/base.h>
+#include <dmlc/data.h>
+#include <dmlc/logging.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "./row_block.h"
+
+namespace dmlc {
+namespace data {
+/*!
+ * \brief gives every block of the wrapped parser, and each of its extra
+ *  sections, 16 or 32 bit indices (RowBlock::index16 / index32) when its
+ *  largest index fits. The narrow copy is set beside index, which stays
+ *  valid for readers that do not know the narrow storage; the other arrays
+ *  of the block are passed through. Containers filled from these blocks,
+ *  e.g. the in memory and cache iterators, keep only the narrow storage.
+ * \tparam IndexType type of index in RowBlock
+ * \tparam DType type of label and value in RowBlock
+ */
+template <typename IndexType, typename DType = real_t>
+class CompactIndexParser : public Parser<IndexType, DType> {
+ public:
+  /*!
+   * \brief constructor
+   * \param base the parser to wrap, owned by this parser
+   */
+  explicit CompactIndexParser(Parser<IndexType, DType> *base)
+      : base_(base) {}
+  virtual ~CompactIndexParser(void) {
+    delete base_;
+  }
+  virtual void BeforeFirst(void) {
+    base_->BeforeFirst();
+  }
+  virtual bool Next(void) {
+    if (!base_->Next()) return false;
+    const RowBlock<IndexType, DType> &batch = base_->Value();
+    block_ = batch;
+    if (sections_.size() < batch.extra.size() + 1) sections_.resize(batch.extra.size() + 1);
+    this->Narrow(batch.offset[0], batch.offset[batch.size], &sections_[0], &block_);
+    for (size_t i = 0; i < batch.extra.size(); ++i) {
+      UnitBlock<IndexType> &unit = block_.extra[i];
+      size_t begin = unit.width != 0 ? 0 : unit.offset[0];
+      size_t end = unit.width != 0 ? unit.size * unit.width : unit.offset[unit.size];
+      this->Narrow(begin, end, &sections_[i + 1], &unit);
+    }
+    return true;
+  }
+  virtual const RowBlock<IndexType, DType> &Value(void) const {
+    return block_;
+  }
+  virtual size_t BytesRead(void) const {
+    return base_->BytesRead();
+  }
+  virtual const DataStats *Stats(void) {
+    return base_->Stats();
+  }
+
+ private:
+  /*! \brief narrow copy of the indices of one section */
+  struct Section {
+    std::vector<uint16_t> index16;
+    std::vector<uint32_t> index32;
+  };
+  /*! \brief the wrapped parser */
+  Parser<IndexType, DType> *base_;
+  /*! \brief the current block */
+  RowBlock<IndexType, DType> block_;
+  /*! \brief narrow indices of the block, then of every extra section */
+  std::vector<Section> sections_;
+  /*!
+   * \brief set a narrow copy of the indices [begin, end) of block beside
+   *  its index when they fit, the copy keeps the offsets of the block
+   * \tparam Block RowBlock or UnitBlock
+   */
+  template<typename Block>
+  inline static void Narrow(size_t begin, size_t end, Section *buf, Block *block) {
+    if (block->index == NULL || begin == end || sizeof(IndexType) <= sizeof(uint16_t)) return;
+    const IndexType max = rowblock::MaxValue(block->index + begin, end - begin);
+    const uint64_t m = static_cast<uint64_t>(max);
+    if (m <= std::numeric_limits<uint16_t>::max()) {
+      buf->index16.resize(end);
+      rowblock::CopyIndex(block->index + begin, end - begin,
+                          BeginPtr(buf->index16) + begin, max);
+      block->index16 = BeginPtr(buf->index16);
+    } else if (m <= std::numeric_limits<uint32_t>::max() &&
+               sizeof(IndexType) > sizeof(uint32_t)) {
+      buf->index32.resize(end);
+      rowblock::CopyIndex(block->index + begin, end - begin,
+                          BeginPtr(buf->index32) + begin, max);
+      block->index32 = BeginPtr(buf->index32);
+    }
+  }
+};
+
+/*!
+ * \brief gives the blocks of the wrapped iterator a valid index when they
+ *  only store 16 or 32 bit indices, i.e. when they are read from a cache
+ *  that was built with compact_index=1. The wide copy is set beside the
+ *  narrow arrays; blocks with an index are passed through.
+ * \tparam IndexType type of index in RowBlock
+ * \tparam DType type of label and value in RowBlock
+ */
+template <typename IndexType, typename DType = real_t>
+class WideIndexRowIter : public RowBlockIter<IndexType, DType> {
+ public:
+  /*!
+   * \brief constructor
+   * \param base the iterator to wrap, owned by this iterator
+   */
+  explicit WideIndexRowIter(RowBlockIter<IndexType, DType> *base)
+      : base_(base) {}
+  virtual ~WideIndexRowIter(void) {
+    delete base_;
+  }
+  virtual void BeforeFirst(void) {
+    base_->BeforeFirst();
+  }
+  virtual bool Next(void) {
+    if (!base_->Next()) return false;
+    const RowBlock<IndexType, DType> &batch = base_->Value();
+    block_ = batch;
+    if (sections_.size() < batch.extra.size() + 1) sections_.resize(batch.extra.size() + 1);
+    this->Widen(batch.offset[0], batch.offset[batch.size], &sections_[0], &block_);
+    for (size_t i = 0; i < batch.extra.size(); ++i) {
+      UnitBlock<IndexType> &unit = block_.extra[i];
+      size_t begin = unit.width != 0 ? 0 : unit.offset[0];
+      size_t end = unit.width != 0 ? unit.size * unit.width : unit.offset[unit.size];
+      this->Widen(begin, end, &sections_[i + 1], &unit);
+    }
+    return true;
+  }
+  virtual const RowBlock<IndexType, DType> &Value(void) const {
+    return block_;
+  }
+  virtual size_t NumCol(void) const {
+    return base_->NumCol();
+  }
+  virtual const DataStats *Stats(void) {
+    return base_->Stats();
+  }
+
+ private:
+  /*! \brief the wrapped iterator */
+  RowBlockIter<IndexType, DType> *base_;
+  /*! \brief the current block */
+  RowBlock<IndexType, DType> block_;
+  /*! \brief wide indices of the block, then of every extra section */
+  std::vector<std::vector<IndexType> > sections_;
+  /*!
+   * \brief point the index of block to a wide copy of its narrow indices
+   *  [begin, end), the copy keeps the offsets of the block
+   * \tparam Block RowBlock or UnitBlock
+   */
+  template<typename Block>
+  inline static void Widen(size_t begin, size_t end, std::vector<IndexType> *buf, Block *block) {
+    if (block->index != NULL || begin == end) return;
+    if (block->index16 != NULL) {
+      buf->resize(end);
+      std::copy(block->index16 + begin, block->index16 + end, BeginPtr(*buf) + begin);
+    } else if (block->index32 != NULL) {
+      buf->resize(end);
+      std::copy(block->index32 + begin, block->index32 + end, BeginPtr(*buf) + begin);
+    } else {
+      return;
+    }
+    block->index = BeginPtr(*buf);
+  }
+};
+}  // namespace data
+}  // namespace dmlc
+#endif  // DMLC_DATA_COMPACT_INDEX_PARSER_H_
@@ -17,6 +17,7 @@
 #include <limits>
 #include "./row_block.h"
 #include "./text_parser.h"
+#include "./column_stats.h"
 
 namespace dmlc {
 namespace data {
@@ -27,6 +28,7 @@ struct CSVParserParam : public Parameter<CSVParserParam> {
   size_t label_width;
   std::string delimiter;
   int weight_column;
+  bool column_stats;
   // declare parameters
   DMLC_DECLARE_PARAMETER(CSVParserParam) {
     DMLC_DECLARE_FIELD(format).set_default("csv")
@@ -39,6 +41,9 @@ struct CSVParserParam : public Parameter<CSVParserParam> {
         .describe("Column index that will put into instance weights.");
     DMLC_DECLARE_FIELD(label_width).set_default(1)
         .describe("The width of label.");
+    DMLC_DECLARE_FIELD(column_stats).set_default(false)
+        .describe("If true, collect column statistics of the parsed rows in the "
+                  "parse workers, see Parser::Stats.");
   }
 };
 
@@ -65,6 +70,14 @@ class CSVParser : public TextParserBase<IndexType, DType> {
       << "Must have distinct columns for labels and instance weights";
   }
 
+  virtual void BeforeFirst(void) {
+    TextParserBase<IndexType, DType>::BeforeFirst();
+    stats_.Clear();
+  }
+  virtual const DataStats *Stats(void) {
+    return param_.column_stats ? &stats_.Get() : NULL;
+  }
+
  protected:
   virtual void ParseBlock(const char *begin,
                           const char *end,
@@ -72,6 +85,8 @@ class CSVParser : public TextParserBase<IndexType, DType> {
 
  private:
   CSVParserParam param_;
+  /*! \brief column statistics of the parsed rows, when column_stats is set */
+  ColumnStatsCollector<IndexType, DType> stats_;
 };
 
 template <typename IndexType, typename DType>
@@ -81,6 +96,8 @@ ParseBlock(const char *begin,
            RowBlockContainer<IndexType, DType> *out) {
   out->Clear();
   out->label_width = param_.label_width;
+  const bool kHalf = std::is_same<DType, float16>::value ||
+      std::is_same<DType, bfloat16>::value;
   const char * lbegin = begin;
   const char * lend = lbegin;
   // advance lbegin if it points to newlines
@@ -100,6 +117,7 @@ ParseBlock(const char *begin,
     while (p != lend) {
       char *endptr;
       DType v;
+      real_t fv = 0.0f;
       // if DType is float32
       if (std::is_same<DType, real_t>::value) {
         v = strtof(p, &endptr);
@@ -109,16 +127,22 @@ ParseBlock(const char *begin,
       // If DType is int64
       } else if (std::is_same<DType, int64_t>::value) {
         v = static_cast<int64_t>(strtoll(p, &endptr, 0));
+      // If DType is a 16 bit float, parse as float32 and round,
+      // the weight keeps the float32
+      } else if (kHalf) {
+        fv = strtof(p, &endptr);
+        v = DType(fv);
       // If DType is all other types
       } else {
-        LOG(FATAL) << "Only float32, int32, and int64 are supported for the time being";
+        LOG(FATAL) << "Only float32, float16, bfloat16, int32, and int64 "
+                   << "are supported for the time being";
       }
 
       if (column_index == param_.label_column) {
         label = v;
-      } else if (std::is_same<DType, real_t>::value
+      } else if ((std::is_same<DType, real_t>::value || kHalf)
                  && column_index == param_.weight_column) {
-        weight = v;
+        weight = kHalf ? fv : static_cast<real_t>(v);
       } else {
         if (std::distance(p, static_cast<char const*>(endptr)) != 0) {
           out->value.push_back(v);
@@ -148,6 +172,7 @@ ParseBlock(const char *begin,
   }
   CHECK(out->label.size() + 1 == out->offset.size());
   CHECK(out->weight.size() == 0 || out->weight.size() + 1 == out->offset.size());
+  if (param_.column_stats) stats_.Add(out->GetBlock());
 }
 }  // namespace data
 }  // namespace dmlc
@@ -4,12 +4,25 @@
 #include <dmlc/logging.h>
 #include <dmlc/data.h>
 #include <dmlc/registry.h>
+#include <dmlc/omp.h>
+#include <dmlc/input_split_shuffle.h>
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <limits>
+#include <map>
 #include <string>
+#include <vector>
+#include "io/filesys.h"
 #include "io/uri_spec.h"
 #include "data/parser.h"
 #include "data/basic_row_iter.h"
 #include "data/disk_row_iter.h"
+#include "data/mmap_row_iter.h"
+#include "data/column_stats.h"
+#include "data/compact_index_parser.h"
+#include "data/rebatch_parser.h"
+#include "data/shuffle_parser.h"
 #include "data/libsvm_parser.h"
 #include "data/libfm_parser.h"
 #include "data/csv_parser.h"
@@ -18,49 +31,234 @@
 namespace dmlc {
 /*! \brief namespace for useful input data structure */
 namespace data {
+/*! \brief number of parse threads when nthread is not given */
+const int kDefaultParseThread = 2;
+/*! \brief size of the chunks of shuffle_chunks=1 when shuffle_chunk_mb is not given */
+const size_t kDefaultShuffleChunkMB = 64;
+
+/*!
+ * \brief take the "nthread" argument out of the parser arguments
+ * \param args the arguments, nthread is removed from it
+ * \return number of parse threads, "auto" means one per processor
+ */
+inline int GetParseThread(std::map<std::string, std::string> *args) {
+  std::map<std::string, std::string>::iterator it = args->find("nthread");
+  if (it == args->end()) return kDefaultParseThread;
+  std::string value = it->second;
+  args->erase(it);
+  if (value == "auto") {
+    return std::max(omp_get_num_procs(), 1);
+  }
+  char *end;
+  long nthread = std::strtol(value.c_str(), &end, 10);
+  if (*end != '\0' || nthread <= 0) {
+    LOG(FATAL) << "Invalid nthread=" << value
+               << ", expect a positive integer or auto";
+  }
+  return static_cast<int>(nthread);
+}
+
+/*!
+ * \brief get the "cache_codec" argument of the iterator
+ * \param args the uri arguments
+ * \return codec level of the cache file, 0 when not given
+ */
+inline int GetCacheCodec(const std::map<std::string, std::string> &args) {
+  std::map<std::string, std::string>::const_iterator it = args.find("cache_codec");
+  if (it == args.end()) return 0;
+  char *end;
+  long level = std::strtol(it->second.c_str(), &end, 10);
+  if (*end != '\0' || level < 0 || level > codec::kMaxLevel) {
+    LOG(FATAL) << "Invalid cache_codec=" << it->second
+               << ", expect an integer in [0, " << codec::kMaxLevel << "]";
+  }
+  return static_cast<int>(level);
+}
+
+/*!
+ * \brief take the "batch_size" argument out of the parser arguments
+ * \param args the arguments, batch_size is removed from it
+ * \return number of rows of every block, 0 to keep the parser blocks
+ */
+inline size_t GetBatchSize(std::map<std::string, std::string> *args) {
+  std::map<std::string, std::string>::iterator it = args->find("batch_size");
+  if (it == args->end()) return 0;
+  std::string value = it->second;
+  args->erase(it);
+  char *end;
+  long batch_size = std::strtol(value.c_str(), &end, 10);
+  if (*end != '\0' || batch_size <= 0) {
+    LOG(FATAL) << "Invalid batch_size=" << value << ", expect a positive integer";
+  }
+  return static_cast<size_t>(batch_size);
+}
+
+/*!
+ * \brief take the "shuffle_buffer_mb" argument out of the parser arguments
+ * \param args the arguments, shuffle_buffer_mb is removed from it
+ * \return bytes of the row shuffle buffer, 0 to keep the file order
+ */
+inline size_t GetShuffleBuffer(std::map<std::string, std::string> *args) {
+  std::map<std::string, std::string>::iterator it = args->find("shuffle_buffer_mb");
+  if (it == args->end()) return 0;
+  std::string value = it->second;
+  args->erase(it);
+  char *end;
+  long mb = std::strtol(value.c_str(), &end, 10);
+  if (*end != '\0' || mb <= 0) {
+    LOG(FATAL) << "Invalid shuffle_buffer_mb=" << value << ", expect a positive integer";
+  }
+  return static_cast<size_t>(mb) << 20;
+}
+
+/*!
+ * \brief get the "seed" argument
+ * \param args the uri arguments
+ * \return the random seed, 0 when not given
+ */
+inline uint64_t GetSeed(const std::map<std::string, std::string> &args) {
+  std::map<std::string, std::string>::const_iterator it = args.find("seed");
+  if (it == args.end()) return 0;
+  char *end;
+  unsigned long long seed = std::strtoull(it->second.c_str(), &end, 10);
+  if (it->second.length() == 0 || *end != '\0') {
+    LOG(FATAL) << "Invalid seed=" << it->second << ", expect a non negative integer";
+  }
+  return static_cast<uint64_t>(seed);
+}
+
+/*!
+ * \brief whether ptype is a builtin text format, whose factory reads the
+ *  text source arguments of CreateTextSource and column_stats
+ */
+inline bool IsTextFormat(const std::string &ptype) {
+  return ptype == "libsvm" || ptype == "libfm" || ptype == "csv" || ptype == "rmf";
+}
+
+/*!
+ * \brief total bytes of the files of path, a ';' separated list of files
+ *  and directories, read from the file system without opening them
+ */
+inline size_t TextSourceBytes(const std::string &path) {
+  size_t total = 0;
+  size_t begin = 0;
+  while (begin <= path.length()) {
+    size_t end = std::min(path.find(';', begin), path.length());
+    if (end != begin) {
+      io::URI uri(path.substr(begin, end - begin).c_str());
+      io::FileSystem *fs = io::FileSystem::GetInstance(uri);
+      io::FileInfo info = fs->GetPathInfo(uri);
+      if (info.type == io::kDirectory) {
+        std::vector<io::FileInfo> files;
+        fs->ListDirectory(uri, &files);
+        for (size_t i = 0; i < files.size(); ++i) {
+          if (files[i].type == io::kFile) total += files[i].size;
+        }
+      } else {
+        total += info.size;
+      }
+    }
+    begin = end + 1;
+  }
+  return total;
+}
+
+/*!
+ * \brief create the text input split of a parser. With "shuffle_chunks=1"
+ *  the partition is cut into chunks of about "shuffle_chunk_mb" (default
+ *  kDefaultShuffleChunkMB) that are read in a seeded random order, drawn
+ *  again at every BeforeFirst. Every chunk is still read sequentially with
+ *  the usual readahead, the chunks are large so that seeks stay rare.
+ * \param path the path of the data
+ * \param args the parser arguments, the shuffle arguments and seed are removed
+ * \param part_index the partition to read
+ * \param num_parts number of partitions
+ */
+inline InputSplit *CreateTextSource(const std::string &path,
+                                    std::map<std::string, std::string> *args,
+                                    unsigned part_index,
+                                    unsigned num_parts) {
+  bool shuffle = args->count("shuffle_chunks") != 0 && args->at("shuffle_chunks") == "1";
+  size_t chunk_mb = kDefaultShuffleChunkMB;
+  if (args->count("shuffle_chunk_mb") != 0) {
+    const std::string &value = args->at("shuffle_chunk_mb");
+    char *end;
+    long mb = std::strtol(value.c_str(), &end, 10);
+    if (*end != '\0' || mb <= 0) {
+      LOG(FATAL) << "Invalid shuffle_chunk_mb=" << value << ", expect a positive integer";
+    }
+    chunk_mb = static_cast<size_t>(mb);
+  }
+  uint64_t seed = GetSeed(*args);
+  args->erase("shuffle_chunks");
+  args->erase("shuffle_chunk_mb");
+  args->erase("seed");
+  if (!shuffle) {
+    return InputSplit::Create(path.c_str(), part_index, num_parts, "text");
+  }
+  size_t part_bytes = TextSourceBytes(path) / num_parts;
+  size_t nchunk = std::max<size_t>(part_bytes / (chunk_mb << 20), 1);
+  nchunk = std::min<size_t>(nchunk, std::numeric_limits<unsigned>::max() / num_parts);
+  // InputSplitShuffle takes an int seed, fold the high half in so that
+  // seeds which differ above 32 bits still shuffle differently
+  const uint32_t folded = static_cast<uint32_t>(seed ^ (seed >> 32));
+  return InputSplitShuffle::Create(path.c_str(), part_index, num_parts, "text",
+                                   static_cast<unsigned>(nchunk), static_cast<int>(folded));
+}
+
+/*!
+ * \brief run parser in a thread of its own when threads are enabled,
+ *  keeping the column statistics it collects in its parse workers
+ */
+template<typename IndexType, typename DType>
+inline Parser<IndexType, DType> *ThreadParser(ParserImpl<IndexType, DType> *parser) {
+#if DMLC_ENABLE_STD_THREAD
+  const bool stats = parser->Stats() != NULL;
+  Parser<IndexType, DType> *threaded = new ThreadedParser<IndexType, DType>(parser);
+  if (stats) threaded = new ThreadedStatsParser<IndexType, DType>(threaded, parser);
+  return threaded;
+#else
+  return parser;
+#endif
+}
+
 template<typename IndexType, typename DType = real_t>
 Parser<IndexType, DType> *
 CreateRMFParser(const std::string& path,
                    const std::map<std::string, std::string>& args,
                    unsigned part_index,
                    unsigned num_parts) {
-  InputSplit* source = InputSplit::Create(
-      path.c_str(), part_index, num_parts, "text");
-  ParserImpl<IndexType, DType> *parser = new RMFParser<IndexType, DType>(source, args, 2);
-#if DMLC_ENABLE_STD_THREAD
-  parser = new ThreadedParser<IndexType>(parser);
-#endif
-  return parser;
+  std::map<std::string, std::string> kwargs(args);
+  InputSplit* source = CreateTextSource(path, &kwargs, part_index, num_parts);
+  int nthread = GetParseThread(&kwargs);
+  ParserImpl<IndexType, DType> *parser = new RMFParser<IndexType, DType>(source, kwargs, nthread);
+  return ThreadParser(parser);
 }
 
 template<typename IndexType, typename DType = real_t>
-Parser<IndexType> *
+Parser<IndexType, DType> *
 CreateLibSVMParser(const std::string& path,
                    const std::map<std::string, std::string>& args,
                    unsigned part_index,
                    unsigned num_parts) {
-  InputSplit* source = InputSplit::Create(
-      path.c_str(), part_index, num_parts, "text");
-  ParserImpl<IndexType> *parser = new LibSVMParser<IndexType>(source, args, 2);
-#if DMLC_ENABLE_STD_THREAD
-  parser = new ThreadedParser<IndexType>(parser);
-#endif
-  return parser;
+  std::map<std::string, std::string> kwargs(args);
+  InputSplit* source = CreateTextSource(path, &kwargs, part_index, num_parts);
+  int nthread = GetParseThread(&kwargs);
+  ParserImpl<IndexType, DType> *parser = new LibSVMParser<IndexType, DType>(source, kwargs, nthread);
+  return ThreadParser(parser);
 }
 
 template<typename IndexType, typename DType = real_t>
-Parser<IndexType> *
+Parser<IndexType, DType> *
 CreateLibFMParser(const std::string& path,
                   const std::map<std::string, std::string>& args,
                   unsigned part_index,
                   unsigned num_parts) {
-  InputSplit* source = InputSplit::Create(
-      path.c_str(), part_index, num_parts, "text");
-  ParserImpl<IndexType> *parser = new LibFMParser<IndexType>(source, args, 2);
-#if DMLC_ENABLE_STD_THREAD
-  parser = new ThreadedParser<IndexType>(parser);
-#endif
-  return parser;
+  std::map<std::string, std::string> kwargs(args);
+  InputSplit* source = CreateTextSource(path, &kwargs, part_index, num_parts);
+  int nthread = GetParseThread(&kwargs);
+  ParserImpl<IndexType, DType> *parser = new LibFMParser<IndexType, DType>(source, kwargs, nthread);
+  return ThreadParser(parser);
 }
 
 template<typename IndexType, typename DType = real_t>
@@ -69,9 +267,11 @@ CreateCSVParser(const std::string& path,
                 const std::map<std::string, std::string>& args,
                 unsigned part_index,
                 unsigned num_parts) {
-  InputSplit* source = InputSplit::Create(
-      path.c_str(), part_index, num_parts, "text");
-  return new CSVParser<IndexType, DType>(source, args, 2);
+  std::map<std::string, std::string> kwargs(args);
+  InputSplit* source = CreateTextSource(path, &kwargs, part_index, num_parts);
+  int nthread = GetParseThread(&kwargs);
+  ParserImpl<IndexType, DType> *parser = new CSVParser<IndexType, DType>(source, kwargs, nthread);
+  return ThreadParser(parser);
 }
 
 template<typename IndexType, typename DType = real_t>
@@ -79,7 +279,8 @@ inline Parser<IndexType, DType> *
 CreateParser_(const char *uri_,
               unsigned part_index,
               unsigned num_parts,
-              const char *type) {
+              const char *type,
+              bool parser_stats = true) {
   std::string ptype = type;
   io::URISpec spec(uri_, part_index, num_parts);
   if (ptype == "auto") {
@@ -89,6 +290,34 @@ CreateParser_(const char *uri_,
       ptype = "libsvm";
     }
   }
+  // iterator options are not parser parameters
+  spec.args.erase("mmap_cache");
+  spec.args.erase("cache_codec");
+  size_t batch_size = GetBatchSize(&spec.args);
+  bool drop_last = spec.args.count("batch_drop_last") != 0 &&
+      spec.args.at("batch_drop_last") == "1";
+  spec.args.erase("batch_drop_last");
+  bool compact_index = spec.args.count("compact_index") != 0 &&
+      spec.args.at("compact_index") == "1";
+  spec.args.erase("compact_index");
+  // the parsers collect the statistics, unless an iterator collects them
+  bool column_stats = parser_stats && spec.args.count("column_stats") != 0 &&
+      spec.args.at("column_stats") == "1";
+  if (!parser_stats) spec.args.erase("column_stats");
+  size_t shuffle_buffer = GetShuffleBuffer(&spec.args);
+  // the seed is also used by the input split, see CreateTextSource
+  uint64_t seed = GetSeed(spec.args);
+  // only the builtin text formats read these, other registered factories
+  // get the parser arguments of the uri alone
+  if (!IsTextFormat(ptype)) {
+    if (spec.args.count("shuffle_chunks") != 0 && spec.args.at("shuffle_chunks") == "1") {
+      LOG(FATAL) << "shuffle_chunks is only supported by the text formats, not " << ptype;
+    }
+    spec.args.erase("shuffle_chunks");
+    spec.args.erase("shuffle_chunk_mb");
+    spec.args.erase("seed");
+    spec.args.erase("column_stats");
+  }
 
   const ParserFactoryReg<IndexType, DType>* e =
       Registry<ParserFactoryReg<IndexType, DType> >::Get()->Find(ptype);
@@ -96,7 +325,23 @@ CreateParser_(const char *uri_,
     LOG(FATAL) << "Unknown data type " << ptype;
   }
   // create parser
-  return (*e->body)(spec.uri, spec.args, part_index, num_parts);
+  Parser<IndexType, DType> *parser = (*e->body)(spec.uri, spec.args, part_index, num_parts);
+  // the text parsers collect the statistics in their parse workers,
+  // collect those of the other parsers as their blocks are returned
+  if (column_stats && parser->Stats() == NULL) {
+    parser = new StatsParser<IndexType, DType>(parser);
+  }
+  // narrow first, the adaptors below keep the narrow storage
+  if (compact_index) {
+    parser = new CompactIndexParser<IndexType, DType>(parser);
+  }
+  if (shuffle_buffer != 0) {
+    parser = new ShuffleParser<IndexType, DType>(parser, shuffle_buffer, seed);
+  }
+  if (batch_size != 0) {
+    parser = new RebatchParser<IndexType, DType>(parser, batch_size, drop_last);
+  }
+  return parser;
 }
 
 template<typename IndexType, typename DType = real_t>
@@ -107,18 +352,66 @@ CreateIter_(const char *uri_,
             const char *type) {
   using namespace std;
   io::URISpec spec(uri_, part_index, num_parts);
+  bool mmap_cache = spec.args.count("mmap_cache") != 0 &&
+      spec.args.at("mmap_cache") == "1";
+  if (mmap_cache && spec.cache_file.length() == 0) {
+    LOG(FATAL) << "mmap_cache=1 requires a cache file, e.g. uri#cachefile";
+  }
+  if (spec.args.count("batch_size") != 0) {
+    LOG(FATAL) << "batch_size is only supported by Parser::Create, "
+               << "use RowBlock::Slice on the blocks of a RowBlockIter";
+  }
+  if (spec.args.count("shuffle_buffer_mb") != 0) {
+    LOG(FATAL) << "shuffle_buffer_mb is only supported by Parser::Create, "
+               << "a RowBlockIter replays the order of its first pass";
+  }
+  int codec_level = GetCacheCodec(spec.args);
+  if (codec_level != 0 && mmap_cache) {
+    LOG(FATAL) << "cache_codec cannot be combined with mmap_cache=1, "
+               << "compressed caches are not mapped in place";
+  }
+  bool column_stats = spec.args.count("column_stats") != 0 &&
+      spec.args.at("column_stats") == "1";
+  bool compact_index = spec.args.count("compact_index") != 0 &&
+      spec.args.at("compact_index") == "1";
+  // pass the full uri so that the format arguments reach the parser,
+  // the statistics are collected by the iterator instead
   Parser<IndexType, DType> *parser = CreateParser_<IndexType, DType>
-      (spec.uri.c_str(), part_index, num_parts, type);
-  if (spec.cache_file.length() != 0) {
+      (uri_, part_index, num_parts, type, false);
+  RowBlockIter<IndexType, DType> *iter;
+  if (mmap_cache) {
+#ifndef _WIN32
+    iter = new MMapRowIter<IndexType, DType>(parser, spec.cache_file.c_str(), true);
+#else
+    LOG(FATAL) << "mmap_cache is not supported on Windows";
+    return NULL;
+#endif
+  } else if (spec.cache_file.length() != 0) {
 #if DMLC_ENABLE_STD_THREAD
-    return new DiskRowIter<IndexType, DType>(parser, spec.cache_file.c_str(), true);
+    if (codec_level != 0) {
+      // write the compressed cache up front, DiskRowIter reuses it
+      Stream *fi = Stream::Create(spec.cache_file.c_str(), "r", true);
+      if (fi == NULL) {
+        BuildRowBlockCache(parser, spec.cache_file.c_str(), codec_level);
+      }
+      delete fi;
+    }
+    iter = new DiskRowIter<IndexType, DType>(parser, spec.cache_file.c_str(), true);
 #else
     LOG(FATAL) << "compile with c++0x or c++11 to enable cache file";
     return NULL;
 #endif
   } else {
-    return new BasicRowIter<IndexType, DType>(parser);
+    iter = new BasicRowIter<IndexType, DType>(parser);
+  }
+  if (spec.cache_file.length() != 0 && !compact_index) {
+    // the cache may have been built by a compact_index=1 reader
+    iter = new WideIndexRowIter<IndexType, DType>(iter);
   }
+  if (column_stats) {
+    iter = new StatsRowIter<IndexType, DType>(iter);
+  }
+  return iter;
 }
 
 DMLC_REGISTER_PARAMETER(LibSVMParserParam);
@@ -182,6 +475,42 @@ RowBlockIter<uint64_t, int64_t>::Create(const char *uri,
   return data::CreateIter_<uint64_t, int64_t>(uri, part_index, num_parts, type);
 }
 
+template<>
+RowBlockIter<uint32_t, float16> *
+RowBlockIter<uint32_t, float16>::Create(const char *uri,
+                                        unsigned part_index,
+                                        unsigned num_parts,
+                                        const char *type) {
+  return data::CreateIter_<uint32_t, float16>(uri, part_index, num_parts, type);
+}
+
+template<>
+RowBlockIter<uint64_t, float16> *
+RowBlockIter<uint64_t, float16>::Create(const char *uri,
+                                        unsigned part_index,
+                                        unsigned num_parts,
+                                        const char *type) {
+  return data::CreateIter_<uint64_t, float16>(uri, part_index, num_parts, type);
+}
+
+template<>
+RowBlockIter<uint32_t, bfloat16> *
+RowBlockIter<uint32_t, bfloat16>::Create(const char *uri,
+                                         unsigned part_index,
+                                         unsigned num_parts,
+                                         const char *type) {
+  return data::CreateIter_<uint32_t, bfloat16>(uri, part_index, num_parts, type);
+}
+
+template<>
+RowBlockIter<uint64_t, bfloat16> *
+RowBlockIter<uint64_t, bfloat16>::Create(const char *uri,
+                                         unsigned part_index,
+                                         unsigned num_parts,
+                                         const char *type) {
+  return data::CreateIter_<uint64_t, bfloat16>(uri, part_index, num_parts, type);
+}
+
 template<>
 Parser<uint32_t, real_t> *
 Parser<uint32_t, real_t>::Create(const char *uri_,
@@ -236,6 +565,42 @@ Parser<uint64_t, int64_t>::Create(const char *uri_,
   return data::CreateParser_<uint64_t, int64_t>(uri_, part_index, num_parts, type);
 }
 
+template<>
+Parser<uint32_t, float16> *
+Parser<uint32_t, float16>::Create(const char *uri_,
+                                  unsigned part_index,
+                                  unsigned num_parts,
+                                  const char *type) {
+  return data::CreateParser_<uint32_t, float16>(uri_, part_index, num_parts, type);
+}
+
+template<>
+Parser<uint64_t, float16> *
+Parser<uint64_t, float16>::Create(const char *uri_,
+                                  unsigned part_index,
+                                  unsigned num_parts,
+                                  const char *type) {
+  return data::CreateParser_<uint64_t, float16>(uri_, part_index, num_parts, type);
+}
+
+template<>
+Parser<uint32_t, bfloat16> *
+Parser<uint32_t, bfloat16>::Create(const char *uri_,
+                                   unsigned part_index,
+                                   unsigned num_parts,
+                                   const char *type) {
+  return data::CreateParser_<uint32_t, bfloat16>(uri_, part_index, num_parts, type);
+}
+
+template<>
+Parser<uint64_t, bfloat16> *
+Parser<uint64_t, bfloat16>::Create(const char *uri_,
+                                   unsigned part_index,
+                                   unsigned num_parts,
+                                   const char *type) {
+  return data::CreateParser_<uint64_t, bfloat16>(uri_, part_index, num_parts, type);
+}
+
 // registry
 typedef ParserFactoryReg<uint32_t, real_t> Reg32flt;
 typedef ParserFactoryReg<uint32_t, int32_t> Reg32int32;
@@ -243,12 +608,20 @@ typedef ParserFactoryReg<uint32_t, int64_t> Reg32int64;
 typedef ParserFactoryReg<uint64_t, real_t> Reg64flt;
 typedef ParserFactoryReg<uint64_t, int32_t> Reg64int32;
 typedef ParserFactoryReg<uint64_t, int64_t> Reg64int64;
+typedef ParserFactoryReg<uint32_t, float16> Reg32f16;
+typedef ParserFactoryReg<uint64_t, float16> Reg64f16;
+typedef ParserFactoryReg<uint32_t, bfloat16> Reg32bf16;
+typedef ParserFactoryReg<uint64_t, bfloat16> Reg64bf16;
 DMLC_REGISTRY_ENABLE(Reg32flt);
 DMLC_REGISTRY_ENABLE(Reg32int32);
 DMLC_REGISTRY_ENABLE(Reg32int64);
 DMLC_REGISTRY_ENABLE(Reg64flt);
 DMLC_REGISTRY_ENABLE(Reg64int32);
 DMLC_REGISTRY_ENABLE(Reg64int64);
+DMLC_REGISTRY_ENABLE(Reg32f16);
+DMLC_REGISTRY_ENABLE(Reg64f16);
+DMLC_REGISTRY_ENABLE(Reg32bf16);
+DMLC_REGISTRY_ENABLE(Reg64bf16);
 
 DMLC_REGISTER_DATA_PARSER(
   uint32_t, real_t, libsvm, data::CreateLibSVMParser<uint32_t __DMLC_COMMA real_t>);
@@ -274,5 +647,37 @@ DMLC_REGISTER_DATA_PARSER(
   uint32_t, real_t, rmf, data::CreateRMFParser<uint32_t __DMLC_COMMA real_t>);
 DMLC_REGISTER_DATA_PARSER(
   uint64_t, real_t, rmf, data::CreateRMFParser<uint64_t __DMLC_COMMA real_t>);
+DMLC_REGISTER_DATA_PARSER(
+  uint32_t, float16, libsvm, data::CreateLibSVMParser<uint32_t __DMLC_COMMA float16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint64_t, float16, libsvm, data::CreateLibSVMParser<uint64_t __DMLC_COMMA float16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint32_t, float16, libfm, data::CreateLibFMParser<uint32_t __DMLC_COMMA float16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint64_t, float16, libfm, data::CreateLibFMParser<uint64_t __DMLC_COMMA float16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint32_t, float16, csv, data::CreateCSVParser<uint32_t __DMLC_COMMA float16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint64_t, float16, csv, data::CreateCSVParser<uint64_t __DMLC_COMMA float16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint32_t, float16, rmf, data::CreateRMFParser<uint32_t __DMLC_COMMA float16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint64_t, float16, rmf, data::CreateRMFParser<uint64_t __DMLC_COMMA float16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint32_t, bfloat16, libsvm, data::CreateLibSVMParser<uint32_t __DMLC_COMMA bfloat16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint64_t, bfloat16, libsvm, data::CreateLibSVMParser<uint64_t __DMLC_COMMA bfloat16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint32_t, bfloat16, libfm, data::CreateLibFMParser<uint32_t __DMLC_COMMA bfloat16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint64_t, bfloat16, libfm, data::CreateLibFMParser<uint64_t __DMLC_COMMA bfloat16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint32_t, bfloat16, csv, data::CreateCSVParser<uint32_t __DMLC_COMMA bfloat16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint64_t, bfloat16, csv, data::CreateCSVParser<uint64_t __DMLC_COMMA bfloat16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint32_t, bfloat16, rmf, data::CreateRMFParser<uint32_t __DMLC_COMMA bfloat16>);
+DMLC_REGISTER_DATA_PARSER(
+  uint64_t, bfloat16, rmf, data::CreateRMFParser<uint64_t __DMLC_COMMA bfloat16>);
 
 }  // namespace dmlc
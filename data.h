@@ -7,10 +7,16 @@
 #ifndef DMLC_DATA_H_
 #define DMLC_DATA_H_
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <map>
+#include <type_traits>
+#include <utility>
 #include "./base.h"
+#include "./half.h"
 #include "./io.h"
 #include "./logging.h"
 #include "./registry.h"
@@ -70,14 +76,213 @@ class UnitData {
   /*! \brief length of the sparse vector */
   size_t length;
   /*!
-   * \brief index of each instance
+   * \brief index of each instance, this can be NULL
+   *  for fixed width blocks, indicating the index of entry i is i
    */
   const IndexType *index;
+  /*! \brief index of each instance in two bytes, see UnitBlock::index16 */
+  const uint16_t *index16 = NULL;
+  /*! \brief index of each instance in four bytes, see UnitBlock::index32 */
+  const uint32_t *index32 = NULL;
   /*!
    * \brief array value of each instance, this can be NULL
    *  indicating every value is set to be 1
    */
   const DType *value;
+  /*!
+   * \param i the input index
+   * \return i-th feature, this function is always
+   *  safe even when index == NULL
+   */
+  inline IndexType get_index(size_t i) const {
+    if (index16 != NULL) return static_cast<IndexType>(index16[i]);
+    if (index32 != NULL) return static_cast<IndexType>(index32[i]);
+    return index == NULL ? static_cast<IndexType>(i) : index[i];
+  }
+  /*! \return whether the entries have stored indices, in any storage */
+  inline bool has_index(void) const {
+    return index != NULL || index16 != NULL || index32 != NULL;
+  }
+  /*!
+   * \param i the input index
+   * \return i-th feature value, this function is always
+   *  safe even when value == NULL
+   */
+  inline DType get_value(size_t i) const {
+    return value == NULL ? DType(1.0f) : value[i];
+  }
+};
+
+/*!
+ * \brief a section exported for embedding bag lookups: flat int64 ids,
+ *  int64 offsets starting at 0 and optional per sample weights.
+ *  The arrays are owned by this object, 64-byte aligned and reused when it
+ *  is filled again, so exporting every batch into the same object does not
+ *  allocate once it has seen the largest batch.
+ */
+class EmbeddingBag {
+ public:
+  /*! \brief alignment of the arrays in bytes */
+  static const size_t kAlign = 64;
+  /*! \brief number of bags, i.e. rows */
+  size_t num_bags;
+  /*! \brief number of ids */
+  size_t num_ids;
+  /*! \brief array[num_ids] ids */
+  int64_t *ids;
+  /*! \brief array[num_bags + 1], bag i is ids[offsets[i], offsets[i + 1]) */
+  int64_t *offsets;
+  /*! \brief array[num_ids] per sample weights, NULL if the section has no value */
+  real_t *weights;
+
+  EmbeddingBag(void)
+      : num_bags(0), num_ids(0), ids(NULL), offsets(NULL), weights(NULL) {}
+  EmbeddingBag(EmbeddingBag &&other) noexcept : EmbeddingBag() {
+    this->Swap(&other);
+  }
+  EmbeddingBag &operator=(EmbeddingBag &&other) noexcept {
+    this->Swap(&other);
+    return *this;
+  }
+  EmbeddingBag(const EmbeddingBag &other) = delete;
+  EmbeddingBag &operator=(const EmbeddingBag &other) = delete;
+  ~EmbeddingBag(void) {
+    std::free(ids_.raw);
+    std::free(offsets_.raw);
+    std::free(weights_.raw);
+  }
+  /*!
+   * \brief set the sizes and make room for the arrays,
+   *  storage is only reallocated when it is too small
+   * \param nbags number of bags
+   * \param nids number of ids
+   * \param with_weights whether to provide weights
+   */
+  inline void Resize(size_t nbags, size_t nids, bool with_weights) {
+    num_bags = nbags;
+    num_ids = nids;
+    ids = static_cast<int64_t*>(Reserve(&ids_, nids * sizeof(int64_t)));
+    offsets = static_cast<int64_t*>(Reserve(&offsets_, (nbags + 1) * sizeof(int64_t)));
+    weights = with_weights ?
+        static_cast<real_t*>(Reserve(&weights_, nids * sizeof(real_t))) : NULL;
+  }
+
+ private:
+  /*! \brief an aligned allocation */
+  struct Storage {
+    void *raw = NULL;
+    void *data = NULL;
+    size_t capacity = 0;
+  };
+  Storage ids_, offsets_, weights_;
+  inline static void *Reserve(Storage *s, size_t nbytes) {
+    if (nbytes > s->capacity || s->data == NULL) {
+      std::free(s->raw);
+      s->raw = std::malloc(nbytes + kAlign);
+      CHECK(s->raw != NULL) << "EmbeddingBag: out of memory";
+      size_t addr = reinterpret_cast<size_t>(s->raw);
+      s->data = reinterpret_cast<void*>((addr + kAlign - 1) / kAlign * kAlign);
+      s->capacity = nbytes;
+    }
+    return s->data;
+  }
+  inline void Swap(EmbeddingBag *other) {
+    std::swap(num_bags, other->num_bags);
+    std::swap(num_ids, other->num_ids);
+    std::swap(ids, other->ids);
+    std::swap(offsets, other->offsets);
+    std::swap(weights, other->weights);
+    std::swap(ids_, other->ids_);
+    std::swap(offsets_, other->offsets_);
+    std::swap(weights_, other->weights_);
+  }
+};
+
+template<typename IndexType, typename DType = real_t>
+struct UnitBlock;
+
+/*!
+ * \brief extra sections of one row.
+ *  This is a view: for a row taken from a RowBlock it refers to the extra
+ *  blocks of that RowBlock and section i is computed on access, so taking
+ *  a row does not allocate. It is valid as long as the RowBlock is.
+ * \tparam IndexType type of index
+ * \tparam DType type of value
+ */
+template<typename IndexType, typename DType = real_t>
+class RowExtra {
+ public:
+  /*! \brief iterator over the sections, dereferences to a UnitData */
+  class const_iterator {
+   public:
+    const_iterator(const RowExtra *extra, size_t pos) : extra_(extra), pos_(pos) {}
+    inline UnitData<IndexType, DType> operator*(void) const {
+      return (*extra_)[pos_];
+    }
+    inline const_iterator &operator++(void) {
+      ++pos_;
+      return *this;
+    }
+    inline bool operator==(const const_iterator &other) const {
+      return pos_ == other.pos_;
+    }
+    inline bool operator!=(const const_iterator &other) const {
+      return pos_ != other.pos_;
+    }
+
+   private:
+    const RowExtra *extra_;
+    size_t pos_;
+  };
+  /*! \brief no extra sections */
+  RowExtra(void) : blocks_(NULL), units_(NULL), size_(0), rowid_(0) {}
+  /*!
+   * \brief row rowid of the extra blocks
+   * \param blocks the extra blocks
+   * \param size number of extra blocks
+   * \param rowid the row
+   */
+  RowExtra(const UnitBlock<IndexType, DType> *blocks, size_t size, size_t rowid)
+      : blocks_(blocks), units_(NULL), size_(size), rowid_(rowid) {}
+  /*!
+   * \brief explicitly given sections, e.g. for a Row built by hand,
+   *  the vector must outlive the view
+   * \param units the sections
+   */
+  explicit RowExtra(const std::vector<UnitData<IndexType, DType> > &units)
+      : blocks_(NULL), units_(units.size() == 0 ? NULL : &units[0]),
+        size_(units.size()), rowid_(0) {}
+  /*! \brief a temporary vector would leave the view dangling */
+  explicit RowExtra(std::vector<UnitData<IndexType, DType> > &&units) = delete;
+  /*! \return number of extra sections */
+  inline size_t size(void) const {
+    return size_;
+  }
+  /*! \return whether there is no extra section */
+  inline bool empty(void) const {
+    return size_ == 0;
+  }
+  /*!
+   * \param i the section index
+   * \return the i-th extra section of the row
+   */
+  inline UnitData<IndexType, DType> operator[](size_t i) const;
+  inline const_iterator begin(void) const {
+    return const_iterator(this, 0);
+  }
+  inline const_iterator end(void) const {
+    return const_iterator(this, size_);
+  }
+
+ private:
+  /*! \brief the extra blocks, NULL for explicitly given sections */
+  const UnitBlock<IndexType, DType> *blocks_;
+  /*! \brief explicitly given sections */
+  const UnitData<IndexType, DType> *units_;
+  /*! \brief number of sections */
+  size_t size_;
+  /*! \brief the row in blocks_ */
+  size_t rowid_;
 };
 
 /*!
@@ -102,32 +307,48 @@ class Row {
    * \brief field of each instance
    */
   const IndexType *field;
+  /*! \brief field of each instance in one byte, see RowBlock::field8 */
+  const uint8_t *field8 = NULL;
+  /*! \brief field of each instance in two bytes, see RowBlock::field16 */
+  const uint16_t *field16 = NULL;
   /*!
    * \brief index of each instance
    */
   const IndexType *index;
+  /*! \brief index of each instance in two bytes, see RowBlock::index16 */
+  const uint16_t *index16 = NULL;
+  /*! \brief index of each instance in four bytes, see RowBlock::index32 */
+  const uint32_t *index32 = NULL;
   /*!
    * \brief array value of each instance, this can be NULL
    *  indicating every value is set to be 1
    */
   const DType *value;
   /*!
-   * \brief extra data
+   * \brief extra data, see RowExtra
    */
-  std::vector<UnitData<IndexType> > extra;
+  RowExtra<IndexType> extra;
 
   /*!
    * \param i the input index
    * \return field for i-th feature
    */
   inline IndexType get_field(size_t i) const {
+    if (field8 != NULL) return static_cast<IndexType>(field8[i]);
+    if (field16 != NULL) return static_cast<IndexType>(field16[i]);
     return field[i];
   }
+  /*! \return whether the entries have fields, in any storage */
+  inline bool has_field(void) const {
+    return field != NULL || field8 != NULL || field16 != NULL;
+  }
   /*!
    * \param i the input index
    * \return i-th feature
    */
   inline IndexType get_index(size_t i) const {
+    if (index16 != NULL) return static_cast<IndexType>(index16[i]);
+    if (index32 != NULL) return static_cast<IndexType>(index32[i]);
     return index[i];
   }
   /*!
@@ -167,38 +388,97 @@ class Row {
    */
   template<typename V>
   inline V SDot(const V *weight, size_t size) const {
-    V sum = static_cast<V>(0);
+    if (index16 != NULL) return this->SDot(index16, weight, size);
+    if (index32 != NULL) return this->SDot(index32, weight, size);
+    return this->SDot(index, weight, size);
+  }
+
+ private:
+  /*!
+   * \brief SDot with the indices of the row in the array index,
+   *  summed in AccumType so that 16 bit weights or values are widened
+   */
+  template<typename I, typename V>
+  inline V SDot(const I *index, const V *weight, size_t size) const {
+    typedef typename AccumType<V>::type A;
+    A sum = static_cast<A>(0);
     if (value == NULL) {
       for (size_t i = 0; i < length; ++i) {
         CHECK(index[i] < size) << "feature index exceed bound";
-        sum += weight[index[i]];
+        sum += static_cast<A>(weight[index[i]]);
       }
     } else {
       for (size_t i = 0; i < length; ++i) {
         CHECK(index[i] < size) << "feature index exceed bound";
-        sum += weight[index[i]] * value[i];
+        sum += static_cast<A>(weight[index[i]]) * value[i];
       }
     }
-    return sum;
+    return static_cast<V>(sum);
   }
 };
 
-template<typename IndexType, typename DType = real_t>
+template<typename IndexType, typename DType>
 struct UnitBlock {
   /*! \brief batch size */
   size_t size;
+  /*!
+   * \brief number of entries of every row, 0 if rows have variable length.
+   *  When it is not 0, row i is [i * width, (i + 1) * width) of index and
+   *  value, and offset is not used.
+   */
+  size_t width = 0;
   /*! \brief array[size+1], row pointer to beginning of each rows */
   const size_t *offset;
-  /*! \brief feature index */
+  /*!
+   * \brief feature index, can be NULL when width is not 0,
+   *  indicating the index of each entry is its column in the row
+   */
   const IndexType *index;
+  /*!
+   * \brief feature index in two bytes, set when every index of the block
+   *  fits, see RowBlockContainer::CompactIndex. At most one of index16 and
+   *  index32 is not NULL, index is NULL or an equal copy beside them.
+   */
+  const uint16_t *index16 = NULL;
+  /*! \brief feature index in four bytes, see index16 */
+  const uint32_t *index32 = NULL;
   /*! \brief feature value, can be NULL, indicating all values are 1 */
   const DType *value;
+  /*!
+   * \brief array[size], number of valid entries of each row when width is
+   *  not 0, the rest of the row is padding. Can be NULL, indicating every
+   *  row has width entries.
+   */
+  const size_t *length = NULL;
   inline UnitData<IndexType, DType> operator[](size_t rowid) const;
+  /*!
+   * \brief export the block as embedding bags, one bag per row.
+   *  Offsets are rebased to start at 0, padding of fixed width rows with
+   *  length is skipped, and value becomes the per sample weights.
+   * \param out the output, its buffers are reused
+   */
+  inline void ExportBag(EmbeddingBag *out) const;
+  /*! \return whether the entries have stored indices, in any storage */
+  inline bool has_index(void) const {
+    return index != NULL || index16 != NULL || index32 != NULL;
+  }
+  /*! \return bytes of one stored index, 0 if there are none */
+  inline size_t index_bytes(void) const {
+    return index16 != NULL ? sizeof(uint16_t) : index32 != NULL ? sizeof(uint32_t) :
+        index != NULL ? sizeof(IndexType) : 0;
+  }
   /*! \return memory cost of the block in bytes */
   inline size_t MemCostBytes(void) const {
+    if (width != 0) {
+      size_t ndata = size * width;
+      size_t cost = ndata * this->index_bytes();
+      if (value != NULL) cost += ndata * sizeof(DType);
+      if (length != NULL) cost += size * sizeof(size_t);
+      return cost;
+    }
     size_t cost = size * (sizeof(size_t) + sizeof(DType));
     size_t ndata = offset[size] - offset[0];
-    if (index != NULL) cost += ndata * sizeof(IndexType);
+    cost += ndata * this->index_bytes();
     if (value != NULL) cost += ndata * sizeof(DType);
     return cost;
   }
@@ -212,11 +492,49 @@ struct UnitBlock {
     CHECK(begin <= end && end <= size);
     UnitBlock ret;
     ret.size = end - begin;
+    ret.width = width;
+    if (width != 0) {
+      ret.offset = NULL;
+      ret.index = index == NULL ? NULL : index + begin * width;
+      ret.index16 = index16 == NULL ? NULL : index16 + begin * width;
+      ret.index32 = index32 == NULL ? NULL : index32 + begin * width;
+      ret.value = value == NULL ? NULL : value + begin * width;
+      ret.length = length == NULL ? NULL : length + begin;
+      return ret;
+    }
+    ret.length = NULL;
     ret.offset = offset + begin;
     ret.index = index;
+    ret.index16 = index16;
+    ret.index32 = index32;
     ret.value = value;
     return ret;
   }
+
+ private:
+  /*!
+   * \brief dst[j] = src[j] for j in [0, n), with memcpy when the
+   *  conversion keeps the bits, e.g. uint64_t ids or float weights
+   */
+  template<typename S, typename T>
+  inline static void CopyArray(const S *src, size_t n, T *dst) {
+    if (std::is_same<S, T>::value ||
+        (std::is_integral<S>::value && std::is_integral<T>::value && sizeof(S) == sizeof(T))) {
+      if (n != 0) std::memcpy(dst, src, n * sizeof(T));
+      return;
+    }
+    for (size_t j = 0; j < n; ++j) dst[j] = static_cast<T>(src[j]);
+  }
+  /*! \brief ids[j] = index of entry begin + j for j in [0, n) */
+  inline void CopyIds(size_t begin, size_t n, int64_t *ids) const {
+    if (index16 != NULL) {
+      CopyArray(index16 + begin, n, ids);
+    } else if (index32 != NULL) {
+      CopyArray(index32 + begin, n, ids);
+    } else {
+      CopyArray(index + begin, n, ids);
+    }
+  }
 };
 
 // implementation of operator[]
@@ -225,16 +543,92 @@ inline UnitData<IndexType, DType>
 UnitBlock<IndexType, DType>::operator[](size_t rowid) const {
   CHECK(rowid < size);
   UnitData<IndexType, DType> inst;
-  inst.length = offset[rowid + 1] - offset[rowid];
-  inst.index = index + offset[rowid];
+  size_t begin;
+  if (width != 0) {
+    inst.length = length == NULL ? width : length[rowid];
+    begin = rowid * width;
+  } else {
+    inst.length = offset[rowid + 1] - offset[rowid];
+    begin = offset[rowid];
+  }
+  if (index == NULL) {
+    inst.index = NULL;
+  } else {
+    inst.index = index + begin;
+  }
+  if (index16 != NULL) inst.index16 = index16 + begin;
+  if (index32 != NULL) inst.index32 = index32 + begin;
   if (value == NULL) {
     inst.value = NULL;
   } else {
-    inst.value = value + offset[rowid];
+    inst.value = value + begin;
   }
   return inst;
 }
 
+template<typename IndexType, typename DType>
+inline void UnitBlock<IndexType, DType>::ExportBag(EmbeddingBag *out) const {
+  if (width == 0) {
+    const size_t base = offset[0];
+    const size_t nids = offset[size] - base;
+    out->Resize(size, nids, value != NULL);
+    int64_t *offsets = out->offsets;
+    int64_t *ids = out->ids;
+    for (size_t i = 0; i <= size; ++i) {
+      offsets[i] = static_cast<int64_t>(offset[i] - base);
+    }
+    this->CopyIds(base, nids, ids);
+    if (value != NULL) CopyArray(value + base, nids, out->weights);
+    return;
+  }
+  if (length == NULL) {
+    const size_t nids = size * width;
+    out->Resize(size, nids, value != NULL);
+    int64_t *offsets = out->offsets;
+    int64_t *ids = out->ids;
+    for (size_t i = 0; i <= size; ++i) {
+      offsets[i] = static_cast<int64_t>(i * width);
+    }
+    if (this->has_index()) {
+      this->CopyIds(0, nids, ids);
+    } else {
+      for (size_t i = 0; i < size; ++i) {
+        for (size_t j = 0; j < width; ++j) {
+          ids[i * width + j] = static_cast<int64_t>(j);
+        }
+      }
+    }
+    if (value != NULL) CopyArray(value, nids, out->weights);
+    return;
+  }
+  // padded rows, keep the valid entries only
+  size_t nids = 0;
+  for (size_t i = 0; i < size; ++i) nids += length[i];
+  out->Resize(size, nids, value != NULL);
+  int64_t *offsets = out->offsets;
+  int64_t *ids = out->ids;
+  real_t *weights = out->weights;
+  size_t pos = 0;
+  for (size_t i = 0; i < size; ++i) {
+    offsets[i] = static_cast<int64_t>(pos);
+    const size_t len = length[i];
+    if (this->has_index()) {
+      this->CopyIds(i * width, len, ids + pos);
+    } else {
+      for (size_t j = 0; j < len; ++j) ids[pos + j] = static_cast<int64_t>(j);
+    }
+    if (value != NULL) CopyArray(value + i * width, len, weights + pos);
+    pos += len;
+  }
+  offsets[size] = static_cast<int64_t>(pos);
+}
+
+template<typename IndexType, typename DType>
+inline UnitData<IndexType, DType>
+RowExtra<IndexType, DType>::operator[](size_t i) const {
+  return blocks_ != NULL ? blocks_[i][rowid_] : units_[i];
+}
+
 /*!
  * \brief a block of data, containing several rows in sparse matrix
  *  This is useful for (streaming-sxtyle) algorithms that scans through rows of data
@@ -263,8 +657,26 @@ struct RowBlock {
   const uint64_t *qid;
   /*! \brief field id*/
   const IndexType *field;
+  /*!
+   * \brief field id in one byte, parsers may store small field ids
+   *  this way instead of in field, see Row::get_field.
+   *  At most one of field, field8 and field16 is not NULL.
+   */
+  const uint8_t *field8 = NULL;
+  /*! \brief field id in two bytes, see field8 */
+  const uint16_t *field16 = NULL;
   /*! \brief feature index */
   const IndexType *index;
+  /*!
+   * \brief feature index in two bytes, set when every index of the block
+   *  fits, see RowBlockContainer::CompactIndex and Row::get_index. At most
+   *  one of index16 and index32 is not NULL, index is NULL or an equal copy
+   *  beside them: blocks of compact_index=1 readers may leave it NULL, the
+   *  blocks of other readers always have it.
+   */
+  const uint16_t *index16 = NULL;
+  /*! \brief feature index in four bytes, see index16 */
+  const uint32_t *index32 = NULL;
   /*! \brief feature value, can be NULL, indicating all values are 1 */
   const DType *value;
   // extra format
@@ -282,7 +694,11 @@ struct RowBlock {
     if (qid != NULL) cost += size * sizeof(size_t);
     size_t ndata = offset[size] - offset[0];
     if (field != NULL) cost += ndata * sizeof(IndexType);
+    if (field8 != NULL) cost += ndata * sizeof(uint8_t);
+    if (field16 != NULL) cost += ndata * sizeof(uint16_t);
     if (index != NULL) cost += ndata * sizeof(IndexType);
+    if (index16 != NULL) cost += ndata * sizeof(uint16_t);
+    if (index32 != NULL) cost += ndata * sizeof(uint32_t);
     if (value != NULL) cost += ndata * sizeof(DType);
     return cost;
   }
@@ -293,31 +709,129 @@ struct RowBlock {
    * \return the sliced RowBlock
    */
   inline RowBlock Slice(size_t begin, size_t end) const {
-    CHECK(begin <= end && end <= size);
     RowBlock ret;
-    ret.size = end - begin;
-    ret.label = label + (begin * label_width);
+    this->Slice(begin, end, &ret);
+    return ret;
+  }
+  /*!
+   * \brief slice a RowBlock to get rows in [begin, end), every extra
+   *  section is sliced to the same rows. No data is copied, and the extra
+   *  vector of out is reused, so slicing a block into minibatches with the
+   *  same out does not allocate once out has seen as many extra sections.
+   * \param begin the begin row index
+   * \param end the end row index
+   * \param out the sliced RowBlock
+   */
+  inline void Slice(size_t begin, size_t end, RowBlock *out) const {
+    CHECK(begin <= end && end <= size);
+    out->size = end - begin;
+    out->label_width = label_width;
+    out->label = label + (begin * label_width);
     if (weight != NULL) {
-      ret.weight = weight + begin;
+      out->weight = weight + begin;
     } else {
-      ret.weight = NULL;
+      out->weight = NULL;
     }
     if (qid != NULL) {
-      ret.qid = qid + begin;
+      out->qid = qid + begin;
     } else {
-      ret.qid = NULL;
+      out->qid = NULL;
+    }
+    out->offset = offset + begin;
+    out->field = field;
+    out->field8 = field8;
+    out->field16 = field16;
+    out->index = index;
+    out->index16 = index16;
+    out->index32 = index32;
+    out->value = value;
+    out->extra.resize(extra.size());
+    for (size_t i = 0; i < extra.size(); ++i) {
+      out->extra[i] = extra[i].Slice(begin, end);
+    }
+  }
+  /*!
+   * \brief export the features of the rows, the only section of libsvm
+   *  and libfm data, as embedding bags, see UnitBlock::ExportBag.
+   *  Fields are not exported.
+   * \param out the output, its buffers are reused
+   */
+  inline void ExportBag(EmbeddingBag *out) const {
+    UnitBlock<IndexType, DType> main;
+    main.size = size;
+    main.offset = offset;
+    main.index = index;
+    main.index16 = index16;
+    main.index32 = index32;
+    main.value = value;
+    main.ExportBag(out);
+  }
+  /*!
+   * \brief export the extra sections [begin, end) as embedding bags,
+   *  e.g. the sparse and multi field sections of rmf data,
+   *  see UnitBlock::ExportBag and ExportBag for the features
+   * \param begin the first extra section
+   * \param end one past the last extra section
+   * \param out the output, resized to end - begin, its buffers are reused
+   */
+  inline void ExportBags(size_t begin, size_t end, std::vector<EmbeddingBag> *out) const {
+    CHECK(begin <= end && end <= extra.size());
+    out->resize(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+      extra[i].ExportBag(&(*out)[i - begin]);
     }
-    ret.offset = offset + begin;
-    ret.field = field;
-    ret.index = index;
-    ret.value = value;
-    ret.extra.resize(extra.size());
-    for (size_t i = 0; i < extra.size(); ++i)
-      ret.extra[i] = extra[i].slice(begin, end);
-    return ret;
   }
 };
 
+/*!
+ * \brief statistics of the columns of one section of a dataset.
+ *  Entry c of every array is about column (feature index) index[c], only
+ *  the columns with stored entries are listed, in the order they were
+ *  first merged; the statistics are over the stored entries of the column,
+ *  entries that are not stored are neither counted nor included in min and max.
+ */
+struct ColumnStats {
+  /*! \brief the column of every entry */
+  std::vector<uint64_t> index;
+  /*! \brief number of stored entries */
+  std::vector<uint64_t> nnz;
+  /*! \brief smallest value */
+  std::vector<double> min;
+  /*! \brief largest value */
+  std::vector<double> max;
+  /*! \brief sum of the values */
+  std::vector<double> sum;
+  /*! \brief sum of the squared values */
+  std::vector<double> sumsq;
+  /*! \return number of columns with stored entries */
+  inline size_t size(void) const {
+    return index.size();
+  }
+  /*! \return mean of the stored values of entry c */
+  inline double mean(size_t c) const {
+    return nnz[c] == 0 ? 0.0 : sum[c] / nnz[c];
+  }
+  /*! \return population variance of the stored values of entry c */
+  inline double variance(size_t c) const {
+    if (nnz[c] == 0) return 0.0;
+    double m = this->mean(c);
+    return std::max(sumsq[c] / nnz[c] - m * m, 0.0);
+  }
+};
+
+/*!
+ * \brief column statistics collected while reading a dataset,
+ *  enabled with column_stats=1 in the uri, see Parser::Stats
+ */
+struct DataStats {
+  /*! \brief number of rows */
+  uint64_t num_row = 0;
+  /*! \brief statistics of the columns of the rows */
+  ColumnStats column;
+  /*! \brief statistics of the columns of every extra section, see RowBlock::extra */
+  std::vector<ColumnStats> extra;
+};
+
 /*!
  * \brief Data structure that holds the data
  * Row block iterator interface that gets RowBlocks
@@ -331,7 +845,7 @@ struct RowBlock {
  * \tparam IndexType type of index in RowBlock
  * \tparam DType type of label and value in RowBlock
  *  Create function was only implemented for IndexType uint64_t and uint32_t
- *  and DType real_t and int
+ *  and DType real_t, int32_t, int64_t, float16 and bfloat16
  */
 template<typename IndexType, typename DType = real_t>
 class RowBlockIter : public DataIter<RowBlock<IndexType, DType> > {
@@ -354,6 +868,14 @@ class RowBlockIter : public DataIter<RowBlock<IndexType, DType> > {
          const char *type);
   /*! \return maximum feature dimension in the dataset */
   virtual size_t NumCol() const = 0;
+  /*!
+   * \return column statistics of the blocks returned so far by the first
+   *  pass, complete once the first pass is over. NULL unless the uri has
+   *  column_stats=1.
+   */
+  virtual const DataStats *Stats(void) {
+    return NULL;
+  }
 };
 
 /*!
@@ -370,7 +892,7 @@ class RowBlockIter : public DataIter<RowBlock<IndexType, DType> > {
  * \tparam IndexType type of index in RowBlock
  * \tparam DType type of label and value in RowBlock
  *  Create function was only implemented for IndexType uint64_t and uint32_t
- *  and DType real_t and int
+ *  and DType real_t, int32_t, int64_t, float16 and bfloat16
  */
 template <typename IndexType, typename DType = real_t>
 class Parser : public DataIter<RowBlock<IndexType, DType> > {
@@ -394,6 +916,16 @@ class Parser : public DataIter<RowBlock<IndexType, DType> > {
          const char *type);
   /*! \return size of bytes read so far */
   virtual size_t BytesRead(void) const = 0;
+  /*!
+   * \return column statistics of the rows parsed so far, restarted by
+   *  BeforeFirst. The text parsers collect them in their parse workers,
+   *  so they may include rows of blocks not returned yet, and they are
+   *  complete once Next returned false; they include the rows dropped by
+   *  batch_drop_last. NULL unless the uri has column_stats=1.
+   */
+  virtual const DataStats *Stats(void) {
+    return NULL;
+  }
   /*! \brief Factory type of the parser*/
   typedef Parser<IndexType, DType>* (*Factory)
       (const std::string& path,
@@ -450,6 +982,7 @@ inline Row<IndexType, DType>
 RowBlock<IndexType, DType>::operator[](size_t rowid) const {
   CHECK(rowid < size);
   Row<IndexType, DType> inst;
+  inst.label_width = label_width;
   inst.label = label + (rowid * label_width);
   if (weight != NULL) {
     inst.weight = weight + rowid;
@@ -467,15 +1000,21 @@ RowBlock<IndexType, DType>::operator[](size_t rowid) const {
   } else {
     inst.field = NULL;
   }
-  inst.index = index + offset[rowid];
+  if (field8 != NULL) inst.field8 = field8 + offset[rowid];
+  if (field16 != NULL) inst.field16 = field16 + offset[rowid];
+  if (index != NULL) {
+    inst.index = index + offset[rowid];
+  } else {
+    inst.index = NULL;
+  }
+  if (index16 != NULL) inst.index16 = index16 + offset[rowid];
+  if (index32 != NULL) inst.index32 = index32 + offset[rowid];
   if (value == NULL) {
     inst.value = NULL;
   } else {
     inst.value = value + offset[rowid];
   }
-  inst.extra.resize(extra.size());
-  for (size_t i = 0; i < extra.size(); ++i)
-    inst.extra[i] = extra[i][rowid];
+  inst.extra = RowExtra<IndexType>(BeginPtr(extra), extra.size(), rowid);
   return inst;
 }
 
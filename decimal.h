@@ -0,0 +1,218 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file decimal.h
+ * \brief fast decoders for plain decimal numbers, the fast path is
+ *  locale independent and correctly rounded (hence bit exact with strtof),
+ *  anything it does not cover falls back to strtof
+ */
+#ifndef DMLC_DATA_DECIMAL_H_
+#define DMLC_DATA_DECIMAL_H_
+
+#include <dmlc/base.h>
+#include <cfloat>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace dmlc {
+namespace data {
+namespace decimal {
+/*! \brief exact powers of ten representable as float */
+const float kPow10[] = {
+  1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+/*! \brief powers of ten used to shift the integer mantissa */
+const uint64_t kPow10Int[] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+  10000000ULL, 100000000ULL
+};
+/*! \brief largest integer mantissa that is exact as float */
+const uint64_t kMaxExactMantissa = uint64_t(1) << 24;
+
+inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_MSC_VER)
+#define DMLC_DECIMAL_SWAR 1
+#else
+#define DMLC_DECIMAL_SWAR 0
+#endif
+
+#if DMLC_DECIMAL_SWAR
+/*! \return number of leading decimal digits in the 8 bytes of v */
+inline int CountDigits8(uint64_t v) {
+  // a byte has its high bit set if it is below '0' or above '9'
+  uint64_t bad = ((v + 0x4646464646464646ULL) | (v - 0x3030303030303030ULL))
+      & 0x8080808080808080ULL;
+  if (bad == 0) return 8;
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanForward64(&idx, bad);
+  return static_cast<int>(idx >> 3);
+#else
+  return __builtin_ctzll(bad) >> 3;
+#endif
+}
+/*! \brief convert n <= 8 digits at p into an integer, SWAR style */
+inline uint32_t DigitsToInt(const char *p, int n) {
+  uint64_t v = 0x3030303030303030ULL;
+  // the first digit goes to the lowest used byte, pad the front with '0'
+  std::memcpy(reinterpret_cast<char*>(&v) + (8 - n), p, n);
+  v -= 0x3030303030303030ULL;
+  v = (v * 10) + (v >> 8);
+  v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+       (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+  return static_cast<uint32_t>(v);
+}
+#endif
+
+/*!
+ * \brief accumulate the digit run starting at p into mantissa
+ * \param p beginning of the run
+ * \param end end of the token
+ * \param mantissa the accumulated mantissa
+ * \param ndigit number of significant digits accumulated so far
+ * \return end of the digit run
+ */
+inline const char *ReadDigits(const char *p, const char *end,
+                              uint64_t *mantissa, int *ndigit) {
+  uint64_t m = *mantissa;
+  int nd = *ndigit;
+#if DMLC_DECIMAL_SWAR
+  while (end - p >= 8 && nd <= 11) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    int n = CountDigits8(v);
+    if (n == 0) break;
+    m = m * kPow10Int[n] + DigitsToInt(p, n);
+    if (m != 0) nd += n;
+    p += n;
+    if (n != 8) {
+      *mantissa = m; *ndigit = nd;
+      return p;
+    }
+  }
+#endif
+  for (; p != end && IsDigit(*p); ++p) {
+    if (nd < 19) {
+      m = m * 10 + (*p - '0');
+      if (m != 0) ++nd;
+    } else {
+      // too many significant digits for the fast path
+      nd = 20;
+    }
+  }
+  *mantissa = m;
+  *ndigit = nd;
+  return p;
+}
+}  // namespace decimal
+
+/*!
+ * \brief decode the float in [begin, end) exactly like strtof would,
+ *  characters after the number are ignored.
+ *
+ *  Plain decimals such as "0.278292" or "-12.5e3" with at most 7
+ *  significant digits and a decimal exponent within [-10, 10] are
+ *  converted with a single correctly rounded float operation; anything
+ *  else (long mantissas, large exponents, inf, nan, hex) goes to strtof.
+ * \param begin beginning of the token
+ * \param end end of the token
+ * \return the decoded value, 0 if there is no number
+ */
+inline float ParseDecimalFloat(const char *begin, const char *end) {
+  const char *p = begin;
+  bool neg = false;
+  if (p != end && (*p == '-' || *p == '+')) {
+    neg = (*p == '-');
+    ++p;
+  }
+  uint64_t mantissa = 0;
+  int ndigit = 0;
+  const char *q = decimal::ReadDigits(p, end, &mantissa, &ndigit);
+  bool any = (q != p);
+  int exponent = 0;
+  if (q != end && *q == '.') {
+    const char *f = q + 1;
+    q = decimal::ReadDigits(f, end, &mantissa, &ndigit);
+    exponent = -static_cast<int>(q - f);
+    any = any || (q != f);
+  }
+  if (any && q != end && (*q == 'e' || *q == 'E')) {
+    const char *e = q + 1;
+    bool eneg = false;
+    if (e != end && (*e == '-' || *e == '+')) {
+      eneg = (*e == '-');
+      ++e;
+    }
+    int ev = 0;
+    const char *s = e;
+    for (; e != end && decimal::IsDigit(*e) && ev < 1000; ++e) {
+      ev = ev * 10 + (*e - '0');
+    }
+    if (e != s) {
+      exponent += eneg ? -ev : ev;
+      q = e;
+    }
+  }
+  if (any && ndigit <= 19 &&
+      (q == end || (!decimal::IsDigit(*q) && *q != 'x' && *q != 'X'))) {
+    while (mantissa > decimal::kMaxExactMantissa && mantissa % 10 == 0) {
+      mantissa /= 10;
+      ++exponent;
+    }
+#if FLT_EVAL_METHOD == 0
+    if (mantissa <= decimal::kMaxExactMantissa &&
+        exponent >= -10 && exponent <= 10) {
+      float v = static_cast<float>(mantissa);
+      v = exponent < 0 ? v / decimal::kPow10[-exponent]
+                       : v * decimal::kPow10[exponent];
+      return neg ? -v : v;
+    }
+#endif
+  }
+  // slow path, strtof needs a terminated string
+  char buf[64];
+  const size_t len = end - begin;
+  if (len < sizeof(buf)) {
+    std::memcpy(buf, begin, len);
+    buf[len] = '\0';
+    return std::strtof(buf, NULL);
+  }
+  std::string str(begin, end);
+  return std::strtof(str.c_str(), NULL);
+}
+
+/*!
+ * \brief decode the unsigned integer in [begin, end),
+ *  characters after the number are ignored.
+ * \param begin beginning of the token
+ * \param end end of the token
+ * \param out the decoded value
+ * \return false if there is no number or it overflows I
+ * \tparam I unsigned integer type
+ */
+template<typename I>
+inline bool ParseDecimalUInt(const char *begin, const char *end, I *out) {
+  const char *p = begin;
+  if (p != end && *p == '+') ++p;
+  if (p == end || !decimal::IsDigit(*p)) return false;
+  uint64_t v = 0;
+  for (; p != end && decimal::IsDigit(*p); ++p) {
+    uint64_t d = static_cast<uint64_t>(*p - '0');
+    if (v > (std::numeric_limits<uint64_t>::max() - d) / 10) return false;
+    v = v * 10 + d;
+  }
+  if (v > static_cast<uint64_t>(std::numeric_limits<I>::max())) return false;
+  *out = static_cast<I>(v);
+  return true;
+}
+}  // namespace data
+}  // namespace dmlc
+#endif  // DMLC_DATA_DECIMAL_H_
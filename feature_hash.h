@@ -0,0 +1,156 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file feature_hash.h
+ * \brief hashing of string feature tokens into a feature id range
+ */
+#ifndef DMLC_DATA_FEATURE_HASH_H_
+#define DMLC_DATA_FEATURE_HASH_H_
+
+#include <dmlc/base.h>
+#include <dmlc/logging.h>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "./decimal.h"
+
+namespace dmlc {
+namespace data {
+/*!
+ * \brief seeded 64 bit MurmurHash64A of a byte string,
+ *  fast and non-cryptographic
+ */
+inline uint64_t HashBytes(const char *begin, const char *end, uint64_t seed) {
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+  const size_t len = static_cast<size_t>(end - begin);
+  uint64_t h = seed ^ (len * m);
+  const char *p = begin;
+  for (; end - p >= 8; p += 8) {
+    uint64_t k;
+    std::memcpy(&k, p, sizeof(k));
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+  switch (end - p) {
+    case 7: h ^= static_cast<uint64_t>(static_cast<uint8_t>(p[6])) << 48;  // fall through
+    case 6: h ^= static_cast<uint64_t>(static_cast<uint8_t>(p[5])) << 40;  // fall through
+    case 5: h ^= static_cast<uint64_t>(static_cast<uint8_t>(p[4])) << 32;  // fall through
+    case 4: h ^= static_cast<uint64_t>(static_cast<uint8_t>(p[3])) << 24;  // fall through
+    case 3: h ^= static_cast<uint64_t>(static_cast<uint8_t>(p[2])) << 16;  // fall through
+    case 2: h ^= static_cast<uint64_t>(static_cast<uint8_t>(p[1])) << 8;   // fall through
+    case 1: h ^= static_cast<uint64_t>(static_cast<uint8_t>(p[0]));
+            h *= m;
+  }
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+/*!
+ * \brief maps string tokens to feature ids in [0, num_buckets).
+ *  The same token always gets the same id for the same seed, tokens of
+ *  different fields get independent ids when a per field salt is used.
+ * \tparam IndexType type of the feature id
+ */
+template<typename IndexType>
+class FeatureHasher {
+ public:
+  FeatureHasher(void) : num_buckets_(0), seed_(0), keys_only_(false) {}
+  /*!
+   * \brief set the id range and the seed
+   * \param num_buckets size of the id range, 0 for the whole IndexType range
+   * \param seed the hash seed
+   * \param keys_only whether every token is a whole key without value,
+   *  e.g. raw "uid:12345" ids, see ParseToken
+   */
+  inline void Init(uint64_t num_buckets, uint64_t seed, bool keys_only = false) {
+    CHECK(num_buckets == 0 ||
+          num_buckets - 1 <= static_cast<uint64_t>(std::numeric_limits<IndexType>::max()))
+        << "hash_buckets " << num_buckets << " exceeds the range of the index type";
+    num_buckets_ = num_buckets;
+    seed_ = seed;
+    keys_only_ = keys_only;
+  }
+  /*!
+   * \brief hash the token [begin, end)
+   * \param salt distinguishes fields, 0 for no salt
+   */
+  inline IndexType Hash(const char *begin, const char *end, uint64_t salt) const {
+    uint64_t h = HashBytes(begin, end, seed_ ^ (salt * 0x9e3779b97f4a7c15ULL));
+    if (num_buckets_ == 0) return static_cast<IndexType>(h);
+    return static_cast<IndexType>(h % num_buckets_);
+  }
+  /*!
+   * \brief parse a key[:value] token whose key is an arbitrary string.
+   *  The value is what follows the last ':' when it starts like a number,
+   *  otherwise the whole token is the key, so "user:42:0.5" is the key
+   *  "user:42" with value 0.5 and "user:bob" is a key without value.
+   *  With keys_only the whole token is always the key, so that "uid:12345"
+   *  is not the key "uid" with value 12345.
+   * \param begin beginning of the token, without surrounding blanks
+   * \param end end of the token
+   * \param salt distinguishes fields, 0 for no salt
+   * \param id the hashed key
+   * \param value the value when present
+   * \return 0 for an empty token, 1 for a key only, 2 with a value
+   */
+  inline int ParseToken(const char *begin, const char *end, uint64_t salt,
+                        IndexType *id, real_t *value) const {
+    if (begin == end) return 0;
+    if (keys_only_) {
+      *id = this->Hash(begin, end, salt);
+      return 1;
+    }
+    const char *colon = end;
+    for (const char *p = end; p != begin; --p) {
+      if (*(p - 1) == ':') {
+        colon = p - 1;
+        break;
+      }
+    }
+    if (colon == end || colon == begin || colon + 1 == end ||
+        !((colon[1] >= '0' && colon[1] <= '9') ||
+          colon[1] == '-' || colon[1] == '+' || colon[1] == '.')) {
+      *id = this->Hash(begin, end, salt);
+      return 1;
+    }
+    *id = this->Hash(begin, colon, salt);
+    *value = ParseDecimalFloat(colon + 1, end);
+    return 2;
+  }
+
+ private:
+  /*! \brief size of the id range, 0 for the whole IndexType range */
+  uint64_t num_buckets_;
+  /*! \brief the hash seed */
+  uint64_t seed_;
+  /*! \brief whether tokens are whole keys */
+  bool keys_only_;
+};
+
+/*!
+ * \brief append the value of a parsed feature token to values, which is
+ *  parallel to the nindex feature ids parsed so far, this token's included.
+ *  Key only tokens (r == 1) count as 1: nothing is stored while no token
+ *  had a value, and the first token with a value (r == 2) fills in 1 for
+ *  the key only tokens before it, so that lines mixing "country:us" and
+ *  "price:3.5" keep every value on its feature.
+ * \param r the return value of the token parser, 1 or 2
+ */
+template<typename V>
+inline void PushTokenValue(int r, real_t value, size_t nindex, std::vector<V> *values) {
+  if (r == 2) {
+    if (values->size() + 1 < nindex) values->resize(nindex - 1, V(1.0f));
+    values->push_back(V(value));
+  } else if (values->size() != 0) {
+    values->push_back(V(1.0f));
+  }
+}
+}  // namespace data
+}  // namespace dmlc
+#endif  // DMLC_DATA_FEATURE_HASH_H_
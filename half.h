@@ -0,0 +1,138 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file half.h
+ * \brief 16 bit floating point types used to store feature values
+ */
+#ifndef DMLC_HALF_H_
+#define DMLC_HALF_H_
+
+#include <cstdint>
+#include <cstring>
+
+namespace dmlc {
+/*!
+ * \brief IEEE 754 half precision number, 1 sign, 5 exponent and
+ *  10 mantissa bits. Only storage: it converts from and to float,
+ *  and arithmetic is done on the converted floats.
+ */
+struct float16 {
+  /*! \brief the raw bits */
+  uint16_t bits;
+  /*! \brief default constructor, leaves the bits uninitialized like float */
+  float16(void) = default;
+  /*! \brief convert from float, rounding to nearest even */
+  float16(float f) : bits(FromFloat(f)) {}  // NOLINT(*)
+  /*! \brief convert to float, exactly */
+  inline operator float(void) const {
+    return ToFloat(bits);
+  }
+  /*! \return the half precision bits closest to f */
+  inline static uint16_t FromFloat(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    const uint16_t sign = static_cast<uint16_t>((x >> 16) & 0x8000U);
+    const uint32_t abs = x & 0x7fffffffU;
+    if (abs >= 0x7f800000U) {
+      // inf stays inf, nan stays a quiet nan
+      return sign | (abs > 0x7f800000U ? 0x7e00U : 0x7c00U);
+    }
+    if (abs >= 0x477ff000U) {
+      // rounds to above the largest finite half, 65504
+      return sign | 0x7c00U;
+    }
+    if (abs < 0x38800000U) {
+      // subnormal half, or zero below half of the smallest subnormal
+      if (abs < 0x33000000U) return sign;
+      const uint32_t e = abs >> 23;
+      const uint32_t m = (abs & 0x7fffffU) | 0x800000U;
+      const uint32_t shift = 126 - e;
+      uint32_t h = m >> shift;
+      const uint32_t rest = m & ((1U << shift) - 1);
+      const uint32_t half = 1U << (shift - 1);
+      if (rest > half || (rest == half && (h & 1U))) ++h;
+      return sign | static_cast<uint16_t>(h);
+    }
+    // normal half, the carry of the rounding may move into the exponent
+    uint32_t h = ((abs >> 13) - (112U << 10));
+    const uint32_t rest = abs & 0x1fffU;
+    if (rest > 0x1000U || (rest == 0x1000U && (h & 1U))) ++h;
+    return sign | static_cast<uint16_t>(h);
+  }
+  /*! \return the float of half precision bits h */
+  inline static float ToFloat(uint16_t h) {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000U) << 16;
+    uint32_t e = (h >> 10) & 0x1fU;
+    uint32_t m = h & 0x3ffU;
+    uint32_t x;
+    if (e == 0x1fU) {
+      x = sign | 0x7f800000U | (m << 13);
+    } else if (e != 0) {
+      x = sign | ((e + 112U) << 23) | (m << 13);
+    } else if (m == 0) {
+      x = sign;
+    } else {
+      // subnormal half, normalize the mantissa
+      e = 113;
+      while ((m & 0x400U) == 0) {
+        m <<= 1; --e;
+      }
+      x = sign | (e << 23) | ((m & 0x3ffU) << 13);
+    }
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+  }
+};
+
+/*!
+ * \brief brain floating point number, the upper 16 bits of a float:
+ *  same range as float with 8 mantissa bits. Only storage, see float16.
+ */
+struct bfloat16 {
+  /*! \brief the raw bits */
+  uint16_t bits;
+  /*! \brief default constructor, leaves the bits uninitialized like float */
+  bfloat16(void) = default;
+  /*! \brief convert from float, rounding to nearest even */
+  bfloat16(float f) : bits(FromFloat(f)) {}  // NOLINT(*)
+  /*! \brief convert to float, exactly */
+  inline operator float(void) const {
+    return ToFloat(bits);
+  }
+  /*! \return the bfloat16 bits closest to f */
+  inline static uint16_t FromFloat(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    if ((x & 0x7fffffffU) > 0x7f800000U) {
+      return static_cast<uint16_t>((x >> 16) | 0x40U);
+    }
+    x += 0x7fffU + ((x >> 16) & 1U);
+    return static_cast<uint16_t>(x >> 16);
+  }
+  /*! \return the float of bfloat16 bits h */
+  inline static float ToFloat(uint16_t h) {
+    const uint32_t x = static_cast<uint32_t>(h) << 16;
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+  }
+};
+
+/*!
+ * \brief type to accumulate sums of T in, wider than T for the
+ *  16 bit floats so that long sums do not lose their precision
+ */
+template<typename T>
+struct AccumType {
+  typedef T type;
+};
+template<>
+struct AccumType<float16> {
+  typedef float type;
+};
+template<>
+struct AccumType<bfloat16> {
+  typedef float type;
+};
+}  // namespace dmlc
+#endif  // DMLC_HALF_H_
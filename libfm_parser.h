@@ -11,12 +11,18 @@
 #include <dmlc/strtonum.h>
 #include <dmlc/parameter.h>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <limits>
 #include <algorithm>
 #include <cstring>
+#include <vector>
 #include "./row_block.h"
 #include "./text_parser.h"
+#include "./column_stats.h"
+#include "./text_scanner.h"
+#include "./decimal.h"
 
 namespace dmlc {
 namespace data {
@@ -24,6 +30,8 @@ namespace data {
 struct LibFMParserParam : public Parameter<LibFMParserParam> {
   std::string format;
   int indexing_mode;
+  bool compact_field;
+  bool column_stats;
   // declare parameters
   DMLC_DECLARE_PARAMETER(LibFMParserParam) {
     DMLC_DECLARE_FIELD(format).set_default("libfm")
@@ -35,6 +43,12 @@ struct LibFMParserParam : public Parameter<LibFMParserParam> {
           "If <0, use heuristic to automatically detect mode of indexing. "
           "See https://en.wikipedia.org/wiki/Array_data_type#Index_origin "
           "for more details on indexing modes.");
+    DMLC_DECLARE_FIELD(compact_field).set_default(false)
+        .describe("If true, store the field ids of a block in RowBlock::field8 "
+                  "or RowBlock::field16 when they fit, instead of RowBlock::field.");
+    DMLC_DECLARE_FIELD(column_stats).set_default(false)
+        .describe("If true, collect column statistics of the parsed rows in the "
+                  "parse workers, see Parser::Stats.");
   }
 };
 
@@ -50,11 +64,19 @@ class LibFMParser : public TextParserBase<IndexType, DType> {
   explicit LibFMParser(InputSplit *source,
                        const std::map<std::string, std::string>& args,
                        int nthread)
-      : TextParserBase<IndexType>(source, nthread) {
+      : TextParserBase<IndexType, DType>(source, nthread) {
     param_.Init(args);
     CHECK_EQ(param_.format, "libfm");
   }
 
+  virtual void BeforeFirst(void) {
+    TextParserBase<IndexType, DType>::BeforeFirst();
+    stats_.Clear();
+  }
+  virtual const DataStats *Stats(void) {
+    return param_.column_stats ? &stats_.Get() : NULL;
+  }
+
  protected:
   virtual void ParseBlock(const char *begin,
                           const char *end,
@@ -62,6 +84,61 @@ class LibFMParser : public TextParserBase<IndexType, DType> {
 
  private:
   LibFMParserParam param_;
+  /*! \brief column statistics of the parsed rows, when column_stats is set */
+  ColumnStatsCollector<IndexType, DType> stats_;
+  /*! \brief guards the position buffer pool */
+  std::mutex mutex_;
+  /*! \brief all position buffers created by this parser */
+  std::vector<std::unique_ptr<std::vector<uint32_t> > > pos_;
+  /*! \brief position buffers not used by any parse thread */
+  std::vector<std::vector<uint32_t>*> free_pos_;
+  /*! \brief take a position buffer from the pool, creating one if none is free */
+  inline std::vector<uint32_t> *AcquirePos(void) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_pos_.size() != 0) {
+      std::vector<uint32_t> *pos = free_pos_.back();
+      free_pos_.pop_back();
+      return pos;
+    }
+    pos_.emplace_back(new std::vector<uint32_t>());
+    free_pos_.reserve(pos_.size());
+    return pos_.back().get();
+  }
+  /*! \brief return a position buffer to the pool */
+  inline void ReleasePos(std::vector<uint32_t> *pos) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_pos_.push_back(pos);
+  }
+  /*!
+   * \brief parse a field:feature[:value] token
+   * \param text beginning of the block
+   * \param tbegin beginning of the token
+   * \param tend end of the token
+   * \param cfirst first ':' position inside the token
+   * \param clast one past the last ':' position inside the token
+   * \param fieldId the field id
+   * \param featureId the feature id
+   * \param value the value, set only when 3 is returned
+   * \return number of numbers parsed, the entry is valid when at least 2
+   */
+  inline int ParseEntry(const char *text, uint32_t tbegin, uint32_t tend,
+                        const uint32_t *cfirst, const uint32_t *clast,
+                        IndexType *fieldId, IndexType *featureId, real_t *value) const {
+    const char *b = text + tbegin, *e = text + tend;
+    if (clast - cfirst == 1 || clast - cfirst == 2) {
+      const char *c1 = text + cfirst[0];
+      const char *c2 = clast - cfirst == 2 ? text + cfirst[1] : e;
+      if (ParseDecimalUInt(b, c1, fieldId) &&
+          ParseDecimalUInt(c1 + 1, c2, featureId)) {
+        if (c2 == e) return 2;
+        *value = ParseDecimalFloat(c2 + 1, e);
+        return 3;
+      }
+    }
+    // signs, blanks inside or extra ':' take the generic path
+    const char *q;
+    return ParseTriple<IndexType, IndexType, real_t>(b, e, &q, *fieldId, *featureId, *value);
+  }
 };
 
 template <typename IndexType, typename DType>
@@ -71,69 +148,88 @@ ParseBlock(const char *begin,
            RowBlockContainer<IndexType, DType> *out) {
   out->Clear();
   out->label_width = 1;
-  const char * lbegin = begin;
-  const char * lend = lbegin;
+  // 1-based ids are shifted while parsing, the heuristic needs the whole block
+  const IndexType shift = param_.indexing_mode > 0 ? 1 : 0;
+  // narrow field ids go to field16 until one does not fit
+  std::vector<uint16_t> *field16 = param_.compact_field ? &out->field16 : NULL;
   IndexType min_field_id = std::numeric_limits<IndexType>::max();
   IndexType min_feat_id = std::numeric_limits<IndexType>::max();
-  while (lbegin != end) {
-    // get line end
-    lend = lbegin + 1;
-    while (lend != end && *lend != '\n' && *lend != '\r') ++lend;
-    // parse label[:weight]
-    const char * p = lbegin;
-    const char * q = NULL;
-    real_t label;
-    real_t weight;
-    int r = ParsePair<real_t, real_t>(p, lend, &q, label, weight);
-    if (r < 1) {
-      // empty line
-      lbegin = lend;
-      continue;
-    }
-    if (r == 2) {
-      // has weight
-      out->weight.push_back(weight);
+  IndexType max_field = 0;
+  // locate every line end, blank and ':' at once
+  std::vector<uint32_t> *pos = AcquirePos();
+  ScanStructure<' ', '\t', ':'>(begin, end, pos);
+  const uint32_t nbytes = static_cast<uint32_t>(end - begin);
+  const uint32_t *sp = BeginPtr(*pos);
+  const uint32_t *send = sp + pos->size();
+  uint32_t lbegin = 0;
+  while (lbegin <= nbytes) {
+    bool has_label = false;
+    uint32_t tbegin = lbegin;
+    const uint32_t *cfirst = sp;
+    for (;; ++sp) {
+      const char c = sp == send ? '\n' : begin[*sp];
+      if (c == ':') continue;
+      const uint32_t tend = sp == send ? nbytes : *sp;
+      if (tbegin != tend) {
+        if (!has_label) {
+          // parse label[:weight]
+          const char *q = begin + (cfirst != sp ? *cfirst : tend);
+          out->label.push_back(ParseDecimalFloat(begin + tbegin, q));
+          if (q + 1 < begin + tend) {
+            out->weight.push_back(ParseDecimalFloat(q + 1, begin + tend));
+          }
+          has_label = true;
+        } else {
+          // parse fieldid:feature:value
+          IndexType fieldId, featureId;
+          real_t value;
+          int r = ParseEntry(begin, tbegin, tend, cfirst, sp, &fieldId, &featureId, &value);
+          if (r >= 2) {
+            fieldId -= shift;
+            featureId -= shift;
+            if (field16 != NULL && static_cast<uint64_t>(fieldId) > 0xffff) {
+              // too many fields for the compact storage
+              out->field.assign(field16->begin(), field16->end());
+              field16->clear();
+              field16 = NULL;
+            }
+            if (field16 != NULL) {
+              field16->push_back(static_cast<uint16_t>(fieldId));
+            } else {
+              out->field.push_back(fieldId);
+            }
+            out->index.push_back(featureId);
+            min_field_id = std::min(fieldId, min_field_id);
+            min_feat_id = std::min(featureId, min_feat_id);
+            max_field = std::max(fieldId, max_field);
+            if (r == 3) {
+              // has value
+              out->value.push_back(value);
+            }
+          }
+        }
+      }
+      tbegin = tend + 1;
+      cfirst = sp + 1;
+      if (c == '\n' || c == '\r') break;
     }
-    if (out->label.size() != 0) {
+    if (has_label) {
       out->offset.push_back(out->index.size());
     }
-    out->label.push_back(label);
-    // parse fieldid:feature:value
-    p = q;
-    while (p != lend) {
-      IndexType fieldId;
-      IndexType featureId;
-      real_t value;
-      int r = ParseTriple<IndexType, IndexType, real_t>(p, lend, &q, fieldId, featureId, value);
-      if (r <= 1) {
-        p = q;
-        continue;
-      }
-      out->field.push_back(fieldId);
-      out->index.push_back(featureId);
-      min_field_id = std::min(fieldId, min_field_id);
-      min_feat_id = std::min(featureId, min_feat_id);
-      if (r == 3) {
-        // has value
-        out->value.push_back(value);
-      }
-      p = q;
-    }
+    if (sp == send) break;
     // next line
-    lbegin = lend;
+    lbegin = *sp + 1;
+    ++sp;
   }
-  if (out->label.size() != 0) {
-    out->offset.push_back(out->index.size());
-  }
-  CHECK(out->field.size() == out->index.size());
+  ReleasePos(pos);
+  CHECK(out->field.size() + out->field16.size() == out->index.size());
   CHECK(out->label.size() + 1 == out->offset.size());
 
   // detect indexing mode
   // heuristic adopted from sklearn.datasets.load_svmlight_file
   // If all feature and field id's exceed 0, then detect 1-based indexing
-  if (param_.indexing_mode > 0
-      || (param_.indexing_mode < 0 && !out->index.empty() && min_feat_id > 0
-          && !out->field.empty() && min_field_id > 0) ) {
+  if (param_.indexing_mode < 0 && !out->index.empty()
+      && min_feat_id > 0 && min_field_id > 0) {
     // convert from 1-based to 0-based indexing
     for (IndexType& e : out->index) {
       --e;
@@ -141,7 +237,17 @@ ParseBlock(const char *begin,
     for (IndexType& e : out->field) {
       --e;
     }
+    for (uint16_t& e : out->field16) {
+      --e;
+    }
+    --max_field;
+  }
+  if (out->field16.size() != 0 && max_field <= 0xff) {
+    out->field8.assign(out->field16.begin(), out->field16.end());
+    out->field16.clear();
   }
+  out->max_field = max_field;
+  if (param_.column_stats) stats_.Add(out->GetBlock());
 }
 
 }  // namespace data
@@ -17,6 +17,8 @@
 #include <cstring>
 #include "./row_block.h"
 #include "./text_parser.h"
+#include "./column_stats.h"
+#include "./feature_hash.h"
 
 namespace dmlc {
 namespace data {
@@ -24,6 +26,11 @@ namespace data {
 struct LibSVMParserParam : public Parameter<LibSVMParserParam> {
   std::string format;
   int indexing_mode;
+  bool hash_features;
+  uint64_t hash_buckets;
+  uint64_t hash_seed;
+  bool hash_keys_only;
+  bool column_stats;
   // declare parameters
   DMLC_DECLARE_PARAMETER(LibSVMParserParam) {
     DMLC_DECLARE_FIELD(format).set_default("libsvm")
@@ -35,6 +42,19 @@ struct LibSVMParserParam : public Parameter<LibSVMParserParam> {
           "If <0, use heuristic to automatically detect mode of indexing. "
           "See https://en.wikipedia.org/wiki/Array_data_type#Index_origin "
           "for more details on indexing modes.");
+    DMLC_DECLARE_FIELD(hash_features).set_default(false)
+        .describe("If true, features are arbitrary strings hashed into "
+                  "[0, hash_buckets), indexing_mode is ignored.");
+    DMLC_DECLARE_FIELD(hash_buckets).set_default(0)
+        .describe("Size of the hashed feature range, 0 for the whole index type range.");
+    DMLC_DECLARE_FIELD(hash_seed).set_default(0)
+        .describe("Seed of the feature hash.");
+    DMLC_DECLARE_FIELD(hash_keys_only).set_default(false)
+        .describe("If true, every hashed token is a whole key without value, "
+                  "so that field:id tokens such as uid:12345 are not split at ':'.");
+    DMLC_DECLARE_FIELD(column_stats).set_default(false)
+        .describe("If true, collect column statistics of the parsed rows in the "
+                  "parse workers, see Parser::Stats.");
   }
 };
 
@@ -43,16 +63,27 @@ struct LibSVMParserParam : public Parameter<LibSVMParserParam> {
  * and returns rows in input data
  */
 template <typename IndexType, typename DType = real_t>
-class LibSVMParser : public TextParserBase<IndexType> {
+class LibSVMParser : public TextParserBase<IndexType, DType> {
  public:
   explicit LibSVMParser(InputSplit *source, int nthread)
       : LibSVMParser(source, std::map<std::string, std::string>(), nthread) {}
   explicit LibSVMParser(InputSplit *source,
                         const std::map<std::string, std::string>& args,
                         int nthread)
-      : TextParserBase<IndexType>(source, nthread) {
+      : TextParserBase<IndexType, DType>(source, nthread) {
     param_.Init(args);
     CHECK_EQ(param_.format, "libsvm");
+    if (param_.hash_features) {
+      hasher_.Init(param_.hash_buckets, param_.hash_seed, param_.hash_keys_only);
+    }
+  }
+
+  virtual void BeforeFirst(void) {
+    TextParserBase<IndexType, DType>::BeforeFirst();
+    stats_.Clear();
+  }
+  virtual const DataStats *Stats(void) {
+    return param_.column_stats ? &stats_.Get() : NULL;
   }
 
  protected:
@@ -62,6 +93,10 @@ class LibSVMParser : public TextParserBase<IndexType> {
 
  private:
   LibSVMParserParam param_;
+  /*! \brief column statistics of the parsed rows, when column_stats is set */
+  ColumnStatsCollector<IndexType, DType> stats_;
+  /*! \brief hashes features when hash_features is set */
+  FeatureHasher<IndexType> hasher_;
 };
 
 template <char kSymbol = '#'>
@@ -74,7 +109,7 @@ std::ptrdiff_t IgnoreCommentAndBlank(char const* beg,
       // advance to line end, `ParsePair' will return empty line.
       return length;
     }
-    if (!isblank(*p)) {
+    if (!isblank(static_cast<unsigned char>(*p))) {
       return std::distance(beg, p);  // advance to p
     }
     p++;
@@ -134,7 +169,14 @@ ParseBlock(const char *begin,
       real_t value;
       std::ptrdiff_t advanced = IgnoreCommentAndBlank(p, lend);
       p += advanced;
-      int r = ParsePair<IndexType, real_t>(p, lend, &q, featureId, value);
+      int r;
+      if (param_.hash_features) {
+        q = p;
+        while (q != lend && !isblank(static_cast<unsigned char>(*q))) ++q;
+        r = hasher_.ParseToken(p, q, 0, &featureId, &value);
+      } else {
+        r = ParsePair<IndexType, real_t>(p, lend, &q, featureId, value);
+      }
       if (r < 1) {
         // q is set to line end by `ParsePair', here is p. The latter terminates
         // while loop of parsing features.
@@ -143,10 +185,7 @@ ParseBlock(const char *begin,
       }
       out->index.push_back(featureId);
       min_feat_id = std::min(featureId, min_feat_id);
-      if (r == 2) {
-        // has value
-        out->value.push_back(value);
-      }
+      PushTokenValue(r, value, out->index.size(), &out->value);
       p = q;
     }
     // next line
@@ -156,17 +195,18 @@ ParseBlock(const char *begin,
     out->offset.push_back(out->index.size());
   }
   CHECK(out->label.size() + 1 == out->offset.size());
-
   // detect indexing mode
   // heuristic adopted from sklearn.datasets.load_svmlight_file
-  // If all feature id's exceed 0, then detect 1-based indexing
-  if (param_.indexing_mode > 0
-      || (param_.indexing_mode < 0 && !out->index.empty() && min_feat_id > 0)) {
+  // If all feature id's exceed 0, then detect 1-based indexing.
+  // Hashed ids are bucket numbers, there is no indexing mode to undo.
+  if (!param_.hash_features && (param_.indexing_mode > 0
+      || (param_.indexing_mode < 0 && !out->index.empty() && min_feat_id > 0))) {
     // convert from 1-based to 0-based indexing
     for (IndexType& e : out->index) {
       --e;
     }
   }
+  if (param_.column_stats) stats_.Add(out->GetBlock());
 }
 
 }  // namespace data
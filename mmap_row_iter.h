@@ -0,0 +1,258 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file mmap_row_iter.h
+ * \brief row block iterator over a memory mapped cache file,
+ *  the returned blocks point directly into the mapping
+ */
+#ifndef DMLC_DATA_MMAP_ROW_ITER_H_
+#define DMLC_DATA_MMAP_ROW_ITER_H_
+
+#ifndef _WIN32
+#include <dmlc/base.h>
+#include <dmlc/io.h>
+#include <dmlc/logging.h>
+#include <dmlc/data.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include "./row_block.h"
+
+namespace dmlc {
+namespace data {
+/*!
+ * \brief iterator that maps a binary row block cache into memory.
+ *  No data is copied: epoch 2+ only touches the page cache, pages of
+ *  blocks already visited are released so the resident set stays
+ *  around one block.
+ * \tparam IndexType type of index in RowBlock
+ * \tparam DType type of label and value in RowBlock
+ */
+template<typename IndexType, typename DType = real_t>
+class MMapRowIter : public RowBlockIter<IndexType, DType> {
+ public:
+  /*!
+   * \brief create the iterator, building the cache when needed
+   * \param parser the parser to build the cache from, owned by the iterator
+   * \param cache_file the cache file
+   * \param reuse_cache whether to reuse an existing cache file
+   */
+  MMapRowIter(Parser<IndexType, DType> *parser,
+              const char *cache_file,
+              bool reuse_cache)
+      : cache_file_(cache_file), fd_(-1), data_(NULL), nbytes_(0),
+        cursor_(0), current_(0), num_col_(0) {
+    page_size_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (!reuse_cache || !this->TryMapCache()) {
+      BuildRowBlockCache(parser, cache_file, 0);
+      CHECK(this->TryMapCache()) << "failed to map cache file " << cache_file_;
+    }
+    delete parser;
+  }
+  virtual ~MMapRowIter(void) {
+    if (data_ != NULL) munmap(data_, nbytes_);
+    if (fd_ >= 0) close(fd_);
+  }
+  virtual void BeforeFirst(void) {
+    this->ReleasePages(current_, cursor_);
+    cursor_ = 0;
+    current_ = 0;
+  }
+  virtual bool Next(void) {
+    // the previous block is no longer referenced
+    this->ReleasePages(current_, cursor_);
+    if (cursor_ == nbytes_) return false;
+    const RowBlockHeader &header = this->MapBlock(cursor_, &row_);
+    current_ = cursor_;
+    cursor_ += static_cast<size_t>(header.nbytes);
+    if (cursor_ != nbytes_) {
+      size_t next = reinterpret_cast<const RowBlockHeader*>(data_ + cursor_)->nbytes;
+      this->Advise(cursor_, std::min(cursor_ + next, nbytes_), MADV_WILLNEED);
+    }
+    return true;
+  }
+  virtual const RowBlock<IndexType, DType> &Value(void) const {
+    return row_;
+  }
+  virtual size_t NumCol(void) const {
+    return num_col_;
+  }
+
+ private:
+  /*! \brief name of the cache file */
+  std::string cache_file_;
+  /*! \brief file descriptor of the cache */
+  int fd_;
+  /*! \brief the mapping */
+  char *data_;
+  /*! \brief size of the mapping */
+  size_t nbytes_;
+  /*! \brief begin of the next block */
+  size_t cursor_;
+  /*! \brief begin of the current block */
+  size_t current_;
+  /*! \brief number of columns */
+  size_t num_col_;
+  /*! \brief system page size */
+  size_t page_size_;
+  /*! \brief the current block, pointing into the mapping */
+  RowBlock<IndexType, DType> row_;
+  /*! \brief map the cache file, return false if it does not exist */
+  inline bool TryMapCache(void) {
+    fd_ = open(cache_file_.c_str(), O_RDONLY);
+    if (fd_ < 0) return false;
+    struct stat st;
+    CHECK_EQ(fstat(fd_, &st), 0) << "cannot stat cache file " << cache_file_;
+    nbytes_ = static_cast<size_t>(st.st_size);
+    if (nbytes_ != 0) {
+      void *ptr = mmap(NULL, nbytes_, PROT_READ, MAP_SHARED, fd_, 0);
+      CHECK(ptr != MAP_FAILED) << "cannot map cache file " << cache_file_;
+      data_ = static_cast<char*>(ptr);
+      madvise(data_, nbytes_, MADV_SEQUENTIAL);
+    }
+    // validate the block chain and find the number of columns
+    num_col_ = 0;
+    for (size_t pos = 0; pos != nbytes_;) {
+      const RowBlockHeader &header = this->CheckHeader(pos);
+      num_col_ = std::max(num_col_, static_cast<size_t>(header.max_index) + 1);
+      pos += static_cast<size_t>(header.nbytes);
+    }
+    cursor_ = current_ = 0;
+    return true;
+  }
+  /*! \brief check the header of the block at pos */
+  inline const RowBlockHeader &CheckHeader(size_t pos) const {
+    CHECK(pos % kRowBlockAlign == 0 && pos + sizeof(RowBlockHeader) <= nbytes_)
+        << "Bad RowBlock format in " << cache_file_;
+    const RowBlockHeader &header = *reinterpret_cast<const RowBlockHeader*>(data_ + pos);
+    CHECK(header.magic == kRowBlockMagic && header.version == kRowBlockVersion)
+        << "Bad RowBlock format in " << cache_file_
+        << ", remove the cache file to rebuild it";
+    CHECK((header.types.Check<IndexType, DType>()))
+        << "cache " << cache_file_ << " was written with other index or value types"
+        << ", remove the cache file to rebuild it";
+    CHECK_EQ(header.flags & kRowBlockCompressed, 0U)
+        << "compressed cache " << cache_file_ << " cannot be memory mapped";
+    CHECK(header.nbytes != 0 && header.nbytes <= nbytes_ - pos)
+        << "Bad RowBlock format in " << cache_file_;
+    return header;
+  }
+  /*!
+   * \brief point to the next array of the block
+   * \param p the read position, advanced past the array
+   * \param end the end of the block
+   * \param count the number of elements
+   * \return the array, NULL if it is empty
+   */
+  template<typename T>
+  inline const T *MapArray(const char **p, const char *end, size_t *count) const {
+    CHECK(*p + sizeof(uint64_t) <= end) << "Bad RowBlock format in " << cache_file_;
+    *count = static_cast<size_t>(*reinterpret_cast<const uint64_t*>(*p));
+    *p += sizeof(uint64_t);
+    size_t nbytes = *count * sizeof(T);
+    CHECK(nbytes <= static_cast<size_t>(end - *p)) << "Bad RowBlock format in " << cache_file_;
+    const T *ret = *count == 0 ? NULL : reinterpret_cast<const T*>(*p);
+    *p += rowblock::AlignUp(nbytes, kRowBlockArrayAlign);
+    return ret;
+  }
+  /*! \brief check that the rows of offset are within nindex entries */
+  inline void CheckOffset(const size_t *offset, size_t size, size_t nindex) const {
+    CHECK_LE(offset[0], offset[size]) << "Bad RowBlock format in " << cache_file_;
+    CHECK_LE(offset[size], nindex) << "Bad RowBlock format in " << cache_file_;
+  }
+  /*! \brief check that an optional array of count elements covers nentry entries */
+  inline void CheckEntries(size_t nentry, size_t count) const {
+    CHECK(count == 0 || nentry <= count) << "Bad RowBlock format in " << cache_file_;
+  }
+  /*! \brief set out to the block at pos */
+  inline const RowBlockHeader &MapBlock(size_t pos, RowBlock<IndexType, DType> *out) const {
+    const RowBlockHeader &header = this->CheckHeader(pos);
+    const char *p = data_ + pos + sizeof(RowBlockHeader);
+    const char *end = data_ + pos + header.nbytes;
+    size_t count, nlabel, nweight, nqid, nfield, nfield8, nfield16;
+    size_t nindex, nindex16, nindex32, nvalue;
+    out->label_width = static_cast<size_t>(header.label_width);
+    out->offset = this->MapArray<size_t>(&p, end, &count);
+    CHECK_NE(count, 0U) << "Bad RowBlock format in " << cache_file_;
+    out->size = count - 1;
+    out->label = this->MapArray<DType>(&p, end, &nlabel);
+    out->weight = this->MapArray<real_t>(&p, end, &nweight);
+    out->qid = this->MapArray<uint64_t>(&p, end, &nqid);
+    out->field = this->MapArray<IndexType>(&p, end, &nfield);
+    out->field8 = this->MapArray<uint8_t>(&p, end, &nfield8);
+    out->field16 = this->MapArray<uint16_t>(&p, end, &nfield16);
+    out->index = this->MapArray<IndexType>(&p, end, &nindex);
+    out->index16 = this->MapArray<uint16_t>(&p, end, &nindex16);
+    out->index32 = this->MapArray<uint32_t>(&p, end, &nindex32);
+    out->value = this->MapArray<DType>(&p, end, &nvalue);
+    // the rows must not reach past the mapped arrays of a corrupt cache
+    this->CheckOffset(out->offset, out->size, nindex + nindex16 + nindex32);
+    this->CheckEntries(out->offset[out->size], nvalue);
+    this->CheckEntries(out->offset[out->size], nfield);
+    this->CheckEntries(out->offset[out->size], nfield8);
+    this->CheckEntries(out->offset[out->size], nfield16);
+    CHECK(nlabel == 0 || nlabel == out->size * out->label_width)
+        << "Bad RowBlock format in " << cache_file_;
+    CHECK(nweight == 0 || nweight == out->size) << "Bad RowBlock format in " << cache_file_;
+    CHECK(nqid == 0 || nqid == out->size) << "Bad RowBlock format in " << cache_file_;
+    bool narrow = out->index16 != NULL || out->index32 != NULL;
+    out->extra.resize(static_cast<size_t>(header.num_extra));
+    for (size_t i = 0; i < out->extra.size(); ++i) {
+      CHECK(p + sizeof(UnitBlockHeader) <= end) << "Bad RowBlock format in " << cache_file_;
+      const UnitBlockHeader &uheader = *reinterpret_cast<const UnitBlockHeader*>(p);
+      p += sizeof(UnitBlockHeader);
+      CHECK((uheader.types.Check<IndexType, real_t>()))
+          << "cache " << cache_file_ << " was written with other index or value types"
+          << ", remove the cache file to rebuild it";
+      UnitBlock<IndexType> &unit = out->extra[i];
+      size_t noffset, nlength;
+      unit.width = static_cast<size_t>(uheader.width);
+      unit.offset = this->MapArray<size_t>(&p, end, &noffset);
+      unit.index = this->MapArray<IndexType>(&p, end, &nindex);
+      unit.index16 = this->MapArray<uint16_t>(&p, end, &nindex16);
+      unit.index32 = this->MapArray<uint32_t>(&p, end, &nindex32);
+      nindex += nindex16 + nindex32;
+      unit.value = this->MapArray<real_t>(&p, end, &nvalue);
+      unit.length = this->MapArray<size_t>(&p, end, &nlength);
+      if (unit.width != 0) {
+        unit.offset = NULL;
+        unit.size = std::max(nindex, nvalue) / unit.width;
+        CHECK(nlength == 0 || nlength == unit.size) << "Bad RowBlock format in " << cache_file_;
+        this->CheckEntries(unit.size * unit.width, nindex);
+        this->CheckEntries(unit.size * unit.width, nvalue);
+      } else {
+        CHECK_NE(noffset, 0U) << "Bad RowBlock format in " << cache_file_;
+        unit.size = noffset - 1;
+        unit.length = NULL;
+        this->CheckOffset(unit.offset, unit.size, nindex);
+        this->CheckEntries(unit.offset[unit.size], nvalue);
+      }
+      // rows of the block index the extra sections by row id
+      CHECK_EQ(unit.size, out->size) << "Bad RowBlock format in " << cache_file_;
+      narrow = narrow || unit.index16 != NULL || unit.index32 != NULL;
+    }
+    CHECK_EQ(narrow, (header.flags & kRowBlockNarrowIndex) != 0)
+        << "Bad RowBlock format in " << cache_file_;
+    return header;
+  }
+  /*! \brief give advice on the pages of [begin, end) of the mapping */
+  inline void Advise(size_t begin, size_t end, int advice) const {
+    begin = begin / page_size_ * page_size_;
+    if (end <= begin) return;
+    madvise(data_ + begin, end - begin, advice);
+  }
+  /*! \brief drop the pages of [begin, end) of the mapping from the resident set */
+  inline void ReleasePages(size_t begin, size_t end) const {
+    // keep pages shared with the following block
+    end = end / page_size_ * page_size_;
+    begin = rowblock::AlignUp(begin, page_size_);
+    if (end <= begin) return;
+    madvise(data_ + begin, end - begin, MADV_DONTNEED);
+  }
+};
+}  // namespace data
+}  // namespace dmlc
+#endif  // _WIN32
+#endif  // DMLC_DATA_MMAP_ROW_ITER_H_
@@ -0,0 +1,109 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file rebatch_parser.h
+ * \brief parser adaptor that emits row blocks of a fixed number of rows
+ */
+#ifndef DMLC_DATA_REBATCH_PARSER_H_
+#define DMLC_DATA_REBATCH_PARSER_H_
+
+#include <dmlc/base.h>
+#include <dmlc/data.h>
+#include <dmlc/logging.h>
+#include <algorithm>
+#include "./row_block.h"
+
+namespace dmlc {
+namespace data {
+/*!
+ * \brief emits blocks of exactly batch_size rows, whatever the row count
+ *  of the blocks of the wrapped parser; only the last block may be shorter.
+ *  A batch that lies within one block of the wrapped parser is a zero copy
+ *  slice of it, rows are only copied for batches spanning two blocks.
+ *  Every extra section and all label_width labels follow the rows.
+ * \tparam IndexType type of index in RowBlock
+ * \tparam DType type of label and value in RowBlock
+ */
+template <typename IndexType, typename DType = real_t>
+class RebatchParser : public Parser<IndexType, DType> {
+ public:
+  /*!
+   * \brief constructor
+   * \param base the parser to rebatch, owned by this parser
+   * \param batch_size number of rows of every block
+   * \param drop_last whether to drop the last block if it is shorter
+   */
+  RebatchParser(Parser<IndexType, DType> *base, size_t batch_size, bool drop_last)
+      : base_(base), batch_size_(batch_size), drop_last_(drop_last), pos_(0) {
+    CHECK_NE(batch_size, 0U) << "batch_size must be positive";
+    block_.size = 0;
+  }
+  virtual ~RebatchParser(void) {
+    delete base_;
+  }
+  virtual void BeforeFirst(void) {
+    base_->BeforeFirst();
+    block_.size = 0;
+    pos_ = 0;
+  }
+  virtual bool Next(void) {
+    if (pos_ == block_.size && !this->NextBlock()) return false;
+    if (block_.size - pos_ >= batch_size_) {
+      block_.Slice(pos_, pos_ + batch_size_, &out_);
+      pos_ += batch_size_;
+      return true;
+    }
+    // the batch spans blocks, copy its rows
+    data_.Clear();
+    while (data_.Size() < batch_size_) {
+      if (pos_ == block_.size && !this->NextBlock()) break;
+      size_t end = std::min(block_.size, pos_ + batch_size_ - data_.Size());
+      block_.Slice(pos_, end, &slice_);
+      data_.Push(slice_);
+      pos_ = end;
+    }
+    if (data_.Size() == 0 || (drop_last_ && data_.Size() < batch_size_)) return false;
+    out_ = data_.GetBlock();
+    return true;
+  }
+  virtual const RowBlock<IndexType, DType> &Value(void) const {
+    return out_;
+  }
+  virtual size_t BytesRead(void) const {
+    return base_->BytesRead();
+  }
+  virtual const DataStats *Stats(void) {
+    return base_->Stats();
+  }
+
+ private:
+  /*! \brief move to the next non empty block of base_ */
+  inline bool NextBlock(void) {
+    while (base_->Next()) {
+      block_ = base_->Value();
+      pos_ = 0;
+      if (block_.size != 0) return true;
+    }
+    block_.size = 0;
+    pos_ = 0;
+    return false;
+  }
+  /*! \brief the wrapped parser */
+  Parser<IndexType, DType> *base_;
+  /*! \brief rows of every block */
+  size_t batch_size_;
+  /*! \brief whether to drop the last short block */
+  bool drop_last_;
+  /*! \brief current block of base_ */
+  RowBlock<IndexType, DType> block_;
+  /*! \brief first row of block_ not emitted yet */
+  size_t pos_;
+  /*! \brief rows of a batch spanning blocks */
+  RowBlockContainer<IndexType, DType> data_;
+  /*! \brief slice of block_ pushed into data_ */
+  RowBlock<IndexType, DType> slice_;
+  /*! \brief the current batch */
+  RowBlock<IndexType, DType> out_;
+};
+}  // namespace data
+}  // namespace dmlc
+#endif  // DMLC_DATA_REBATCH_PARSER_H_
@@ -8,30 +8,37 @@
 #define DMLC_DATA_RMF_PARSER_H_ 
 #include <dmlc/data.h>
 #include <dmlc/parameter.h>
+#include <algorithm>
 #include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 #include "./row_block.h"
 #include "./text_parser.h"
+#include "./column_stats.h"
+#include "./text_scanner.h"
+#include "./decimal.h"
+#include "./feature_hash.h"
 #include "./strtonum.h"
 
 namespace dmlc {
 namespace data {
-// TODO check
-namespace {
-void split(const char *s, const char *end, char delim, std::vector<const char* > & out) {
-  if (s == NULL) return;
-  //char *p = const_cast<char *> (s);
-  const char *p = s;
-  out.push_back(p);
-  for (size_t i = 1; i <= end - s; ++i)
-    if (s[i - 1] == delim)
-      out.push_back(p + i);
-}
-}
-
 struct RMFParserParam : public Parameter<RMFParserParam> {
   std::string format;
   int multi_field_num;
   size_t label_width;
+  bool cate_as_index;
+  bool dense_fixed_width;
+  int multi_field_max_len;
+  int multi_field_truncate;
+  bool multi_field_mask;
+  bool hash_features;
+  uint64_t hash_buckets;
+  uint64_t hash_seed;
+  bool hash_field_salt;
+  bool hash_keys_only;
+  bool column_stats;
   // declare parameters
   DMLC_DECLARE_PARAMETER(RMFParserParam) {
     DMLC_DECLARE_FIELD(format).set_default("rmf")
@@ -40,6 +47,39 @@ struct RMFParserParam : public Parameter<RMFParserParam> {
         .describe("The number of multi field feature.");
     DMLC_DECLARE_FIELD(label_width).set_default(1)
         .describe("The number of label.");
+    DMLC_DECLARE_FIELD(cate_as_index).set_default(false)
+        .describe("If true, store the categorical section as fixed width "
+                  "integer ids in index, without value and offset arrays.");
+    DMLC_DECLARE_FIELD(dense_fixed_width).set_default(false)
+        .describe("If true, store the dense section as a contiguous row-major "
+                  "[rows, dense_num] value array, without index and offset arrays.");
+    DMLC_DECLARE_FIELD(multi_field_max_len).set_default(0).set_lower_bound(0)
+        .describe("If positive, store every multi field as a padded row-major "
+                  "[rows, multi_field_max_len] id array with the number of valid "
+                  "ids of each row in length, instead of offset arrays.");
+    DMLC_DECLARE_FIELD(multi_field_truncate).set_default(0)
+        .add_enum("first", 0).add_enum("last", 1)
+        .describe("Which ids of a multi field longer than multi_field_max_len "
+                  "are kept.");
+    DMLC_DECLARE_FIELD(multi_field_mask).set_default(false)
+        .describe("If true, padded multi fields also carry a value array that "
+                  "is the id value (1 when omitted) for valid ids and 0 for padding.");
+    DMLC_DECLARE_FIELD(hash_features).set_default(false)
+        .describe("If true, the ids of the sparse section and of the multi fields "
+                  "are arbitrary strings hashed into [0, hash_buckets).");
+    DMLC_DECLARE_FIELD(hash_buckets).set_default(0)
+        .describe("Size of the hashed id range, 0 for the whole index type range.");
+    DMLC_DECLARE_FIELD(hash_seed).set_default(0)
+        .describe("Seed of the feature hash.");
+    DMLC_DECLARE_FIELD(hash_field_salt).set_default(true)
+        .describe("If true, the same string hashes to different ids in the sparse "
+                  "section and in each multi field.");
+    DMLC_DECLARE_FIELD(hash_keys_only).set_default(false)
+        .describe("If true, every hashed token is a whole key without value, "
+                  "so that field:id tokens such as uid:12345 are not split at ':'.");
+    DMLC_DECLARE_FIELD(column_stats).set_default(false)
+        .describe("If true, collect column statistics of the parsed rows in the "
+                  "parse workers, see Parser::Stats.");
   }
 };
 
@@ -56,10 +96,21 @@ class RMFParser : public TextParserBase<IndexType, DType> {
   explicit RMFParser(InputSplit *source,
                      const std::map<std::string, std::string>& args,
                         int nthread)
-      : TextParserBase<IndexType>(source, nthread) {
+      : TextParserBase<IndexType, DType>(source, nthread) {
     param_.Init(args);
     CHECK_GT(param_.multi_field_num, 1);
     CHECK_EQ(param_.format, "rmf");
+    if (param_.hash_features) {
+      hasher_.Init(param_.hash_buckets, param_.hash_seed, param_.hash_keys_only);
+    }
+  }
+
+  virtual void BeforeFirst(void) {
+    TextParserBase<IndexType, DType>::BeforeFirst();
+    stats_.Clear();
+  }
+  virtual const DataStats *Stats(void) {
+    return param_.column_stats ? &stats_.Get() : NULL;
   }
 
  protected:
@@ -68,65 +119,194 @@ class RMFParser : public TextParserBase<IndexType, DType> {
                           RowBlockContainer<IndexType, DType> *out);
  private:
   RMFParserParam param_;
-// TODO check
-  void ParseLibSVMUnitData(const char *lbegin,
-                     const char *lend,
-                     UnitBlockContainer<IndexType> *out) {
-    const char * p = lbegin;
-    const char * q = NULL;
-    if (out->index.size() != 0) {
-      out->offset.push_back(out->index.size());
+  /*! \brief column statistics of the parsed rows, when column_stats is set */
+  ColumnStatsCollector<IndexType, DType> stats_;
+  /*! \brief hashes string ids when hash_features is set */
+  FeatureHasher<IndexType> hasher_;
+  /*! \brief position index of the structural characters of a block */
+  typedef const uint32_t *PosIter;
+  /*! \brief scratch space of one parse thread, reused across blocks */
+  struct Workspace {
+    /*! \brief structural positions of the current block */
+    std::vector<uint32_t> pos;
+    /*! \brief positions of the multi field separators of the current line */
+    std::vector<PosIter> fields;
+  };
+  /*! \brief guards the workspace pool */
+  std::mutex mutex_;
+  /*! \brief all workspaces created by this parser */
+  std::vector<std::unique_ptr<Workspace> > workspace_;
+  /*! \brief workspaces not used by any parse thread */
+  std::vector<Workspace*> free_workspace_;
+  /*! \brief take a workspace from the pool, creating one if none is free */
+  inline Workspace *AcquireWorkspace(void) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_workspace_.size() != 0) {
+      Workspace *ws = free_workspace_.back();
+      free_workspace_.pop_back();
+      return ws;
+    }
+    workspace_.emplace_back(new Workspace());
+    Workspace *ws = workspace_.back().get();
+    ws->fields.reserve(param_.multi_field_num);
+    free_workspace_.reserve(workspace_.size());
+    return ws;
+  }
+  /*! \brief return a workspace to the pool */
+  inline void ReleaseWorkspace(Workspace *ws) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_workspace_.push_back(ws);
+  }
+  /*!
+   * \brief parse one record whose four '\001' separators are sep[0..3]
+   * \param text beginning of the block
+   * \param lbegin offset of the line begin
+   * \param lend offset of the line end
+   * \param lfirst first structural position of the line
+   * \param sep positions of the section separators
+   * \param llast one past the last structural position of the line
+   * \param ws the workspace of the calling thread
+   * \param out the output container
+   */
+  void ParseLine(const char *text, uint32_t lbegin, uint32_t lend,
+                 PosIter lfirst, const PosIter sep[4], PosIter llast,
+                 Workspace *ws,
+                 RowBlockContainer<IndexType, DType> *out);
+  // parse one feature[:value] token, salt is the extra slot of the section
+  inline int ParseFeature(const char *tbegin, const char *tend, size_t salt,
+                          IndexType *featureId, real_t *value) const {
+    if (param_.hash_features) {
+      return hasher_.ParseToken(tbegin, tend, param_.hash_field_salt ? salt : 0,
+                                featureId, value);
     }
-    // parse feature[:value]
-    while (p != lend) {
+    const char *q = NULL;
+    return ParsePair<IndexType, real_t>(tbegin, tend, &q, *featureId, *value);
+  }
+  // parse space separated feature[:value] tokens
+  void ParseLibSVMUnitData(const char *text, uint32_t sbegin, uint32_t send,
+                           PosIter dfirst, PosIter dlast, size_t salt,
+                           UnitBlockContainer<IndexType> *out) {
+    ForEachToken(text, sbegin, send, dfirst, dlast,
+                 [this, salt, out](const char *tbegin, const char *tend, char) {
       IndexType featureId;
       real_t value;
-      int r = ParsePair<IndexType, real_t>(p, lend, &q, featureId, value);
-      if (r < 1) {
-        p = q;
-        continue;
-      }
+      int r = ParseFeature(tbegin, tend, salt, &featureId, &value);
+      if (r < 1) return;
       out->index.push_back(featureId);
-      if (r == 2) {
-        // has value
-        out->value.push_back(value);
-      }
-      p = q;
+      PushTokenValue(r, value, out->index.size(), &out->value);
+    });
+    out->offset.push_back(out->index.size());
+  }
+  // parse comma separated ids into a padded fixed width row
+  void ParsePaddedField(const char *text, uint32_t sbegin, uint32_t send,
+                        PosIter dfirst, PosIter dlast, size_t salt,
+                        UnitBlockContainer<IndexType> *out) {
+    const size_t width = static_cast<size_t>(param_.multi_field_max_len);
+    const bool keep_last = param_.multi_field_truncate == 1;
+    out->width = width;
+    const size_t base = out->index.size();
+    out->index.resize(base + width, 0);
+    IndexType *ids = BeginPtr(out->index) + base;
+    real_t *mask = NULL;
+    if (param_.multi_field_mask) {
+      out->value.resize(base + width, 0.0f);
+      mask = BeginPtr(out->value) + base;
+    }
+    // with keep_last the row is a ring buffer, rotated into order below
+    size_t n = 0;
+    ForEachToken(text, sbegin, send, dfirst, dlast,
+                 [&](const char *tbegin, const char *tend, char) {
+      if (n >= width && !keep_last) return;
+      IndexType featureId;
+      real_t value;
+      int r = ParseFeature(tbegin, tend, salt, &featureId, &value);
+      if (r < 1) return;
+      size_t slot = n % width;
+      ids[slot] = featureId;
+      if (mask != NULL) mask[slot] = (r == 2) ? value : 1.0f;
+      ++n;
+    });
+    if (n > width) {
+      std::rotate(ids, ids + n % width, ids + width);
+      if (mask != NULL) std::rotate(mask, mask + n % width, mask + width);
+    }
+    n = std::min(n, width);
+    for (size_t i = 0; i < n; ++i) {
+      out->max_index = std::max(out->max_index, ids[i]);
+    }
+    out->length.push_back(n);
+  }
+  // parse multi field ids in the configured layout
+  void ParseMultiField(const char *text, uint32_t sbegin, uint32_t send,
+                       PosIter dfirst, PosIter dlast, size_t salt,
+                       UnitBlockContainer<IndexType> *out) {
+    if (param_.multi_field_max_len > 0) {
+      ParsePaddedField(text, sbegin, send, dfirst, dlast, salt, out);
+    } else {
+      ParseLibSVMUnitData(text, sbegin, send, dfirst, dlast, salt, out);
     }
   }
-// TODO check
-  void ParseCSVUnitData(const char *lbegin,
-                     const char *lend,
-                     UnitBlockContainer<IndexType> *out) {
-    const char* p = lbegin;
-    int column_index = 0;
+  // parse space separated dense values, index is the column id
+  void ParseCSVUnitData(const char *text, uint32_t sbegin, uint32_t send,
+                        PosIter dfirst, PosIter dlast,
+                        UnitBlockContainer<IndexType> *out) {
     IndexType idx = 0;
-
-    while (p != lend) {
-      char *endptr;
-      float v = strtof(p, &endptr);
-      p = endptr;
-      out->value.push_back(v);
+    ForEachToken(text, sbegin, send, dfirst, dlast,
+                 [out, &idx](const char *tbegin, const char *tend, char) {
+      if (tbegin == tend) return;
+      out->value.push_back(ParseDecimalFloat(tbegin, tend));
       out->index.push_back(idx++);
-      ++column_index;
-      while (*p != ' ' && p != lend) ++p;
-      if (p != lend) ++p;
-    }
+    });
     out->offset.push_back(out->index.size());
   }
-
-  void ParseCSVLabel(const char *lbegin,
-                     const char *lend,
-                     std::vector<real_t> &labels) {
-    const char* p = lbegin;
-    while (p != lend) {
-      char *endptr;
-      real_t v = strtof(p, &endptr);
-      p = endptr;
-      labels.push_back(v);
-      while (*p != ' ' && p != lend) ++p;
-      if (p != lend) ++p;
+  // parse space separated dense values into a fixed width row, index is implied
+  void ParseDenseValues(const char *text, uint32_t sbegin, uint32_t send,
+                        PosIter dfirst, PosIter dlast,
+                        UnitBlockContainer<IndexType> *out) {
+    const size_t nbefore = out->value.size();
+    ForEachToken(text, sbegin, send, dfirst, dlast,
+                 [out](const char *tbegin, const char *tend, char) {
+      if (tbegin == tend) return;
+      out->value.push_back(ParseDecimalFloat(tbegin, tend));
+    });
+    CheckFixedWidth(out->value.size() - nbefore, "dense", out);
+  }
+  // parse space separated categorical ids into a fixed width row
+  void ParseCateIndex(const char *text, uint32_t sbegin, uint32_t send,
+                      PosIter dfirst, PosIter dlast,
+                      UnitBlockContainer<IndexType> *out) {
+    const size_t nbefore = out->index.size();
+    IndexType max_index = out->max_index;
+    ForEachToken(text, sbegin, send, dfirst, dlast,
+                 [out, &max_index](const char *tbegin, const char *tend, char) {
+      if (tbegin == tend) return;
+      IndexType id;
+      CHECK(ParseDecimalUInt(tbegin, tend, &id))
+          << "invalid categorical id " << std::string(tbegin, tend);
+      out->index.push_back(id);
+      max_index = std::max(max_index, id);
+    });
+    out->max_index = max_index;
+    CheckFixedWidth(out->index.size() - nbefore, "categorical", out);
+  }
+  // the first row of a fixed width section declares its width
+  void CheckFixedWidth(size_t n, const char *section,
+                       UnitBlockContainer<IndexType> *out) {
+    if (out->width == 0) {
+      CHECK_GT(n, 0U) << "empty " << section << " section";
+      out->width = n;
     }
+    CHECK_EQ(n, out->width) << section << " section must have a fixed width";
+  }
+  // parse space separated labels
+  void ParseCSVLabel(const char *text, uint32_t sbegin, uint32_t send,
+                     PosIter dfirst, PosIter dlast,
+                     std::vector<DType> *labels) {
+    ForEachToken(text, sbegin, send, dfirst, dlast,
+                 [labels](const char *tbegin, const char *tend, char) {
+      if (tbegin == tend) return;
+      labels->push_back(ParseDecimalFloat(tbegin, tend));
+    });
   }
 };
 
@@ -138,42 +318,95 @@ ParseBlock(const char *begin,
   out->Clear();
   out->label_width = param_.label_width;
   out->extra.resize(3 + param_.multi_field_num);
-  const char * lbegin = begin;
-  const char * lend = lbegin;
-  while (lbegin != end) {
-    // get line end
-    lend = lbegin + 1;
-    while (lend != end && *lend != '\n' && *lend != '\r') ++lend;
-    if (lend == end) break;
-    const char * p = lbegin;
-    const char * q = nullptr;
-    real_t label;
-    real_t weight;
-    std::vector<const char* > feats;
-    split(p, lend, '\001', feats);
-    if (feats.size() != 5) continue;
-    ParseCSVLabel(feats[0], feats[1], out->label);
-    // parse fieldid:feature:value
-    ParseCSVUnitData(feats[1], feats[2], &(out->extra[0]));  // dense
-    ParseCSVUnitData(feats[2], feats[3], &(out->extra[1]));  // cate
-    ParseLibSVMUnitData(feats[4], lend, &(out->extra[2]));//sparse
-    std::vector<const char* > multi_fields;
-    split(feats[3], feats[4] - 2, ' ', multi_fields);
-    if ( param_.multi_field_num != multi_fields.size())
-      LOG(FATAL) << "The length of RMFParser's multi fields array isnot fixed " << param_.multi_field_num << " vs " << multi_fields.size(); 
-    for (int i = 0; i < multi_fields.size() - 1; ++i)
-      ParseLibSVMUnitData(multi_fields[i], multi_fields[i+1] - 1, &(out->extra[3 + i]));//multi field
-    ParseLibSVMUnitData(multi_fields[multi_fields.size() - 1], feats[4] - 1, &(out->extra[2 + param_.multi_field_num]));//multi field
+  Workspace *ws = AcquireWorkspace();
+  // locate every line end, section separator and token delimiter at once
+  ScanStructure<'\001', ' ', ','>(begin, end, &ws->pos);
+  const uint32_t nbytes = static_cast<uint32_t>(end - begin);
+  PosIter sp = BeginPtr(ws->pos);
+  PosIter send = sp + ws->pos.size();
+  uint32_t lbegin = 0;
+  while (lbegin < nbytes) {
+    // get line end and the section separators
+    PosIter lfirst = sp;
+    PosIter sep[4];
+    int nsep = 0;
+    for (; sp != send && begin[*sp] != '\n' && begin[*sp] != '\r'; ++sp) {
+      if (begin[*sp] == '\001') {
+        if (nsep < 4) sep[nsep] = sp;
+        ++nsep;
+      }
+    }
+    const uint32_t lend = (sp == send) ? nbytes : *sp;
+    // skip empty and malformed lines
+    if (nsep == 4) {
+      ParseLine(begin, lbegin, lend, lfirst, sep, sp, ws, out);
+    }
+    if (sp == send) break;
     // next line
-    lbegin = lend;
+    lbegin = *sp + 1;
+    ++sp;
   }
-  if (out->label.size() != 0) {
-    for (size_t i = 2; i < out->extra.size(); ++i) {
-      out->extra[i].offset.push_back(out->extra[i].index.size());
-      CHECK((out->label.size() / param_.label_width) + 1 == out->extra[i].offset.size());
-    }
-    out->offset.resize(1 + (out->label.size() / param_.label_width));
+  ReleaseWorkspace(ws);
+  out->offset.resize(1 + (out->label.size() / param_.label_width));
+  for (size_t i = 0; i < out->extra.size(); ++i) {
+    CHECK(out->Size() == out->extra[i].Size());
+  }
+  if (param_.column_stats) stats_.Add(out->GetBlock());
+}
+
+template <typename IndexType, typename DType>
+void RMFParser<IndexType, DType>::
+ParseLine(const char *text, uint32_t lbegin, uint32_t lend,
+          PosIter lfirst, const PosIter sep[4], PosIter llast,
+          Workspace *ws,
+          RowBlockContainer<IndexType, DType> *out) {
+  ParseCSVLabel(text, lbegin, *sep[0], lfirst, sep[0], &out->label);
+  if (param_.dense_fixed_width) {
+    ParseDenseValues(text, *sep[0] + 1, *sep[1], sep[0] + 1, sep[1],
+                     &(out->extra[0]));  // dense
+  } else {
+    ParseCSVUnitData(text, *sep[0] + 1, *sep[1], sep[0] + 1, sep[1],
+                     &(out->extra[0]));  // dense
+  }
+  if (param_.cate_as_index) {
+    ParseCateIndex(text, *sep[1] + 1, *sep[2], sep[1] + 1, sep[2],
+                   &(out->extra[1]));  // cate
+  } else {
+    ParseCSVUnitData(text, *sep[1] + 1, *sep[2], sep[1] + 1, sep[2],
+                     &(out->extra[1]));  // cate
+  }
+  ParseLibSVMUnitData(text, *sep[3] + 1, lend, sep[3] + 1, llast, 2,
+                      &(out->extra[2]));  // sparse
+  // multi fields are separated by ' ', ids inside a field by ','
+  // a trailing ' ' before the section end does not open a new field
+  const uint32_t mbegin = *sep[2] + 1;
+  const uint32_t mend = *sep[3];
+  PosIter mlast = sep[3];
+  if (mlast != sep[2] + 1 && *(mlast - 1) + 1 == mend && text[*(mlast - 1)] == ' ') {
+    --mlast;
+  }
+  // collect the field separators, never beyond the reserved capacity
+  ws->fields.clear();
+  int nfield = 1;
+  for (PosIter it = sep[2] + 1; it != mlast; ++it) {
+    if (text[*it] != ' ') continue;
+    if (nfield < param_.multi_field_num) ws->fields.push_back(it);
+    ++nfield;
+  }
+  if (param_.multi_field_num != nfield)
+    LOG(FATAL) << "The length of RMFParser's multi fields array isnot fixed "
+               << param_.multi_field_num << " vs " << nfield;
+  uint32_t fbegin = mbegin;
+  PosIter ffirst = sep[2] + 1;
+  for (size_t i = 0; i < ws->fields.size(); ++i) {
+    PosIter it = ws->fields[i];
+    ParseMultiField(text, fbegin, *it, ffirst, it, 3 + i,
+                    &(out->extra[3 + i]));  // multi field
+    fbegin = *it + 1;
+    ffirst = it + 1;
   }
+  ParseMultiField(text, fbegin, mend, ffirst, mlast, 2 + param_.multi_field_num,
+                  &(out->extra[2 + param_.multi_field_num]));  // multi field
 }
 
 }  // namespace data
@@ -15,9 +15,308 @@
 #include <vector>
 #include <limits>
 #include <algorithm>
+#include <string>
+#include <type_traits>
+#include "./cache_codec.h"
 
 namespace dmlc {
 namespace data {
+/*!
+ * \brief code of the label and value type of a row block, see
+ *  RowBlockTypes, so that a cache is not read back as another type
+ */
+template<typename DType>
+struct RowBlockDType;
+template<>
+struct RowBlockDType<float> {
+  static const uint32_t kCode = 1;
+};
+template<>
+struct RowBlockDType<double> {
+  static const uint32_t kCode = 2;
+};
+template<>
+struct RowBlockDType<int32_t> {
+  static const uint32_t kCode = 3;
+};
+template<>
+struct RowBlockDType<int64_t> {
+  static const uint32_t kCode = 4;
+};
+template<>
+struct RowBlockDType<float16> {
+  static const uint32_t kCode = 5;
+};
+template<>
+struct RowBlockDType<bfloat16> {
+  static const uint32_t kCode = 6;
+};
+/*! \brief index and value type stored in the headers of the binary format */
+struct RowBlockTypes {
+  /*! \brief sizeof the index type */
+  uint32_t index_bytes;
+  /*! \brief RowBlockDType of the value type */
+  uint32_t dtype;
+  /*! \brief set the types of a writer with IndexType and DType */
+  template<typename IndexType, typename DType>
+  inline void Set(void) {
+    index_bytes = static_cast<uint32_t>(sizeof(IndexType));
+    dtype = RowBlockDType<DType>::kCode;
+  }
+  /*! \return whether a reader with IndexType and DType can read the data */
+  template<typename IndexType, typename DType>
+  inline bool Check(void) const {
+    return index_bytes == sizeof(IndexType) && dtype == RowBlockDType<DType>::kCode;
+  }
+};
+/*!
+ * \brief header of a row block in the binary format.
+ *  Every array that follows is stored as a uint64_t count and the data,
+ *  padded to kRowBlockArrayAlign bytes, and the whole block is padded to
+ *  kRowBlockAlign bytes, so a mapped cache file can be used in place.
+ *  Blocks flagged kRowBlockCompressed store the same arrays encoded by
+ *  codec::ArrayEncoder instead, and are not padded.
+ */
+struct RowBlockHeader {
+  /*! \brief kRowBlockMagic */
+  uint64_t magic;
+  /*! \brief kRowBlockVersion */
+  uint32_t version;
+  /*! \brief kRowBlockCompressed and kRowBlockNarrowIndex, or 0 */
+  uint32_t flags;
+  /*! \brief total bytes of the block, including header and padding */
+  uint64_t nbytes;
+  /*! \brief label width of each instance */
+  uint64_t label_width;
+  /*! \brief maximum value of field */
+  uint64_t max_field;
+  /*! \brief maximum value of index */
+  uint64_t max_index;
+  /*! \brief number of extra sections */
+  uint64_t num_extra;
+  /*! \brief index and value type of the writer */
+  RowBlockTypes types;
+};
+/*! \brief header of an extra section in the binary format */
+struct UnitBlockHeader {
+  /*! \brief fixed width of the rows, 0 for variable length */
+  uint64_t width;
+  /*! \brief maximum value of index */
+  uint64_t max_index;
+  /*! \brief index and value type of the writer */
+  RowBlockTypes types;
+};
+/*! \brief magic number that starts every saved row block, "DMLCRBLK" */
+const uint64_t kRowBlockMagic = 0x4b4c4252434c4d44ULL;
+/*! \brief version of the binary row block format */
+const uint32_t kRowBlockVersion = 7;
+/*! \brief alignment of every array in a saved row block */
+const size_t kRowBlockArrayAlign = 8;
+/*! \brief saved row blocks are padded to a multiple of this */
+const size_t kRowBlockAlign = 4096;
+/*!
+ * \brief flag of blocks whose arrays are stored with codec::ArrayEncoder,
+ *  such blocks are packed without alignment and cannot be mapped in place
+ */
+const uint32_t kRowBlockCompressed = 1;
+/*!
+ * \brief flag of blocks that store indices in index16 or index32, of the
+ *  rows or of an extra section. They come from readers that opted in with
+ *  compact_index=1, a reader of the cache that did not gets them widened,
+ *  see WideIndexRowIter.
+ */
+const uint32_t kRowBlockNarrowIndex = 2;
+/*! \brief memory cost of rows accumulated before a cache block is written */
+const size_t kRowBlockCacheBytes = 64UL << 20UL;
+
+namespace rowblock {
+inline size_t AlignUp(size_t nbytes, size_t align) {
+  return (nbytes + align - 1) / align * align;
+}
+/*! \return bytes taken by the array in the binary format */
+template<typename T>
+inline size_t ArrayBytes(const std::vector<T> &vec) {
+  return sizeof(uint64_t) + AlignUp(vec.size() * sizeof(T), kRowBlockArrayAlign);
+}
+/*! \brief write zero bytes */
+inline void WritePadding(Stream *fo, size_t nbytes) {
+  static const char kZero[kRowBlockAlign] = {0};
+  for (; nbytes > sizeof(kZero); nbytes -= sizeof(kZero)) {
+    fo->Write(kZero, sizeof(kZero));
+  }
+  if (nbytes != 0) fo->Write(kZero, nbytes);
+}
+/*! \brief skip bytes of the input stream */
+inline bool SkipBytes(Stream *fi, size_t nbytes) {
+  char buf[256];
+  while (nbytes != 0) {
+    size_t n = std::min(nbytes, sizeof(buf));
+    if (fi->Read(buf, n) != n) return false;
+    nbytes -= n;
+  }
+  return true;
+}
+/*! \brief write an array in the binary format */
+template<typename T>
+inline void WriteArray(Stream *fo, const std::vector<T> &vec) {
+  uint64_t count = vec.size();
+  size_t nbytes = vec.size() * sizeof(T);
+  fo->Write(&count, sizeof(count));
+  if (nbytes != 0) fo->Write(BeginPtr(vec), nbytes);
+  WritePadding(fo, AlignUp(nbytes, kRowBlockArrayAlign) - nbytes);
+}
+/*! \brief read an array in the binary format */
+template<typename T>
+inline bool ReadArray(Stream *fi, std::vector<T> *vec) {
+  uint64_t count;
+  if (fi->Read(&count, sizeof(count)) != sizeof(count)) return false;
+  vec->resize(static_cast<size_t>(count));
+  size_t nbytes = vec->size() * sizeof(T);
+  if (nbytes != 0 && fi->Read(BeginPtr(*vec), nbytes) != nbytes) return false;
+  return SkipBytes(fi, AlignUp(nbytes, kRowBlockArrayAlign) - nbytes);
+}
+/*!
+ * \brief maximum of an array, 0 when it is empty.
+ *  Independent branch free accumulators let the loop vectorize.
+ */
+template<typename T>
+inline T MaxValue(const T *data, size_t n) {
+  T m0 = 0, m1 = 0, m2 = 0, m3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    m0 = m0 < data[i] ? data[i] : m0;
+    m1 = m1 < data[i + 1] ? data[i + 1] : m1;
+    m2 = m2 < data[i + 2] ? data[i + 2] : m2;
+    m3 = m3 < data[i + 3] ? data[i + 3] : m3;
+  }
+  for (; i < n; ++i) m0 = m0 < data[i] ? data[i] : m0;
+  return std::max(std::max(m0, m1), std::max(m2, m3));
+}
+/*!
+ * \brief copy an index array, converting it to T.
+ *  Arrays of the same type are copied with memcpy, otherwise the
+ *  range is checked once for the whole array.
+ * \return the maximum of the array, 0 when it is empty
+ */
+template<typename I, typename T>
+inline T CopyIndex(const I *src, size_t n, T *dst) {
+  if (n == 0) return 0;
+  if (std::is_same<I, T>::value) {
+    std::memcpy(dst, src, n * sizeof(T));
+    return MaxValue(dst, n);
+  }
+  I m0 = 0, m1 = 0;
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    m0 = m0 < src[i] ? src[i] : m0;
+    m1 = m1 < src[i + 1] ? src[i + 1] : m1;
+    dst[i] = static_cast<T>(src[i]);
+    dst[i + 1] = static_cast<T>(src[i + 1]);
+  }
+  for (; i < n; ++i) {
+    m0 = m0 < src[i] ? src[i] : m0;
+    dst[i] = static_cast<T>(src[i]);
+  }
+  I m = std::max(m0, m1);
+  CHECK_LE(m, std::numeric_limits<T>::max())
+      << "index exceed numeric bound of current type";
+  return static_cast<T>(m);
+}
+/*!
+ * \brief copy an index array whose maximum is already known, converting
+ *  it to T, without scanning it again
+ * \param max the maximum of src, checked against the range of T
+ */
+template<typename I, typename T>
+inline void CopyIndex(const I *src, size_t n, T *dst, I max) {
+  if (n == 0) return;
+  CHECK_LE(static_cast<uint64_t>(max), static_cast<uint64_t>(std::numeric_limits<T>::max()))
+      << "index exceed numeric bound of current type";
+  if (std::is_same<I, T>::value) {
+    std::memcpy(dst, src, n * sizeof(T));
+    return;
+  }
+  for (size_t i = 0; i < n; ++i) dst[i] = static_cast<T>(src[i]);
+}
+/*! \brief dst[i] = src[i] + delta, delta may wrap to subtract */
+inline void RebaseOffsets(const size_t *src, size_t n, size_t delta, size_t *dst) {
+  for (size_t i = 0; i < n; ++i) dst[i] = src[i] + delta;
+}
+/*!
+ * \brief append ids to a storage made of two narrow arrays n0, n1 and a
+ *  wide array w, at most one of which is not empty. The storage only gets
+ *  wider: narrow ids stay narrow while they fit, wide ids always go to w.
+ * \param src the ids
+ * \param n number of ids
+ * \param narrow whether src is narrow storage, i.e. N0 or N1
+ * \return the maximum of the ids, 0 when there are none
+ */
+template<typename I, typename N0, typename N1, typename W>
+inline W PushNarrow(const I *src, size_t n, bool narrow,
+                    std::vector<N0> *n0, std::vector<N1> *n1, std::vector<W> *w) {
+  if (n == 0) return 0;
+  const I max = MaxValue(src, n);
+  const uint64_t m = static_cast<uint64_t>(max);
+  int level = w->size() != 0 ? 2 : n1->size() != 0 ? 1 : 0;
+  if (!narrow || m > std::numeric_limits<N1>::max()) {
+    level = 2;
+  } else if (sizeof(I) > sizeof(N0)) {
+    level = std::max(level, 1);
+  }
+  if (level == 1 && sizeof(N1) >= sizeof(W)) level = 2;
+  if (level == 0) {
+    n0->resize(n0->size() + n);
+    CopyIndex(src, n, BeginPtr(*n0) + n0->size() - n, max);
+  } else if (level == 1) {
+    if (n0->size() != 0) {
+      n1->assign(n0->begin(), n0->end());
+      n0->clear();
+    }
+    n1->resize(n1->size() + n);
+    CopyIndex(src, n, BeginPtr(*n1) + n1->size() - n, max);
+  } else {
+    if (n0->size() != 0) {
+      w->assign(n0->begin(), n0->end());
+      n0->clear();
+    } else if (n1->size() != 0) {
+      w->assign(n1->begin(), n1->end());
+      n1->clear();
+    }
+    w->resize(w->size() + n);
+    CopyIndex(src, n, BeginPtr(*w) + w->size() - n, max);
+  }
+  return static_cast<W>(m);
+}
+/*! \brief append n zeros to the storage of PushNarrow */
+template<typename N0, typename N1, typename W>
+inline void PadNarrow(size_t n, std::vector<N0> *n0, std::vector<N1> *n1, std::vector<W> *w) {
+  if (n0->size() != 0) {
+    n0->resize(n0->size() + n, 0);
+  } else if (n1->size() != 0) {
+    n1->resize(n1->size() + n, 0);
+  } else {
+    w->resize(w->size() + n, 0);
+  }
+}
+/*!
+ * \brief move the ids of the wide array w into the narrowest of n0 and n1
+ *  that holds max, keep them in w otherwise
+ */
+template<typename N0, typename N1, typename W>
+inline void CompactNarrow(uint64_t max, std::vector<N0> *n0, std::vector<N1> *n1,
+                          std::vector<W> *w) {
+  if (w->size() == 0) return;
+  if (max <= std::numeric_limits<N0>::max() && sizeof(N0) < sizeof(W)) {
+    n0->assign(w->begin(), w->end());
+  } else if (max <= std::numeric_limits<N1>::max() && sizeof(N1) < sizeof(W)) {
+    n1->assign(w->begin(), w->end());
+  } else {
+    return;
+  }
+  w->clear();
+}
+}  // namespace rowblock
+
 /*!
  * \brief dynamic data structure that holds
  *        a row block of unit data
@@ -25,12 +324,30 @@ namespace data {
  */
 template<typename IndexType, typename DType = real_t>
 struct UnitBlockContainer {
+  /*!
+   * \brief number of entries of every row, 0 if rows have variable length.
+   *  When it is not 0, offset is not maintained, see UnitBlock::width.
+   *  It is kept across Clear.
+   */
+  size_t width = 0;
   /*! \brief array[size+1], row pointer to beginning of each rows */
   std::vector<size_t> offset;
-  /*! \brief feature index */
+  /*! \brief feature index, empty for fixed width dense data */
   std::vector<IndexType> index;
-  /*! \brief feature value */
+  /*!
+   * \brief feature index in two bytes, see UnitBlock::index16.
+   *  At most one of index, index16 and index32 is not empty.
+   */
+  std::vector<uint16_t> index16;
+  /*! \brief feature index in four bytes, see UnitBlock::index32 */
+  std::vector<uint32_t> index32;
+  /*! \brief feature value, row-major [rows, width] when width is not 0 */
   std::vector<DType> value;
+  /*!
+   * \brief valid entries of each row when width is not 0, see UnitBlock::length.
+   *  Either empty, meaning every row is full, or one entry per row.
+   */
+  std::vector<size_t> length;
   /*! \brief maximum value of index */
   IndexType max_index;
   // constructor
@@ -40,81 +357,243 @@ struct UnitBlockContainer {
   /*! \brief clear the container */
   inline void Clear(void) {
     offset.clear(); offset.push_back(0);
-    index.clear(); value.clear();
+    index.clear(); value.clear(); length.clear();
+    index16.clear(); index32.clear();
     max_index = 0;
   }
+  /*! \brief size of the data */
+  inline size_t Size(void) const {
+    if (width != 0) {
+      return std::max(this->IndexSize(), value.size()) / width;
+    }
+    return offset.size() - 1;
+  }
+  /*! \return number of stored indices, whatever their width */
+  inline size_t IndexSize(void) const {
+    return index.size() + index16.size() + index32.size();
+  }
+  /*! \return whether the indices are stored in index16 or index32 */
+  inline bool HasNarrowIndex(void) const {
+    return index16.size() != 0 || index32.size() != 0;
+  }
   /*! \return estimation of memory cost of this container */
   inline size_t MemCostBytes(void) const {
-    return offset.size() * sizeof(size_t) +
+    return (width != 0 ? length.size() : offset.size()) * sizeof(size_t) +
         index.size() * sizeof(IndexType) +
+        index16.size() * sizeof(uint16_t) +
+        index32.size() * sizeof(uint32_t) +
         value.size() * sizeof(DType);
   }
+  /*!
+   * \brief move index into index16 or index32 when max_index fits,
+   *  later pushes keep the narrow storage while the indices fit
+   */
+  inline void CompactIndex(void) {
+    rowblock::CompactNarrow(max_index, &index16, &index32, &index);
+  }
+  /*!
+   * \brief append indices, see rowblock::PushNarrow
+   * \param src the indices
+   * \param n number of indices
+   * \param narrow whether src is index16 or index32 storage
+   */
+  template<typename I>
+  inline void PushIndex(const I *src, size_t n, bool narrow) {
+    max_index = std::max(max_index, static_cast<IndexType>(
+        rowblock::PushNarrow(src, n, narrow, &index16, &index32, &index)));
+  }
   /*! \brief convert to a row block */
   inline UnitBlock<IndexType, DType> GetBlock(void) const;
   /*!
-   * \brief push the unit row into container
+   * \brief push the unit row into container,
+   *  a fixed width row shorter than width is padded with 0,
+   *  a row without index gets index 0 .. length - 1 in a variable width container
    * \param row the row to push back
    * \tparam I the index type of the row
    */
   template<typename I, typename D>
   inline void Push(UnitData<I, D> row) {
-    for (size_t i = 0; i < row.length; ++i) {
-      CHECK_LE(row.index[i], std::numeric_limits<IndexType>::max())
-          << "index exceed numeric bound of current type";
-      IndexType findex = static_cast<IndexType>(row.index[i]);
-      index.push_back(findex);
-      max_index = std::max(max_index, findex);
+    if (width != 0) {
+      CHECK_LE(row.length, width) << "row length exceeds fixed width";
+      if (row.length != width && length.size() == 0) length.resize(this->Size(), width);
+      if (length.size() != 0) length.push_back(row.length);
+    } else if (!row.has_index()) {
+      for (size_t i = 0; i < row.length; ++i) {
+        if (index16.size() != 0) {
+          index16.push_back(static_cast<uint16_t>(i));
+        } else if (index32.size() != 0) {
+          index32.push_back(static_cast<uint32_t>(i));
+        } else {
+          index.push_back(static_cast<IndexType>(i));
+        }
+      }
+      if (row.length != 0) {
+        max_index = std::max(max_index, static_cast<IndexType>(row.length - 1));
+      }
+    }
+    if (row.index16 != NULL) {
+      this->PushIndex(row.index16, row.length, true);
+    } else if (row.index32 != NULL) {
+      this->PushIndex(row.index32, row.length, true);
+    } else if (row.index != NULL) {
+      this->PushIndex(row.index, row.length, false);
     }
     if (row.value != NULL) {
       for (size_t i = 0; i < row.length; ++i) {
         value.push_back(row.value[i]);
       }
     }
-    offset.push_back(index.size());
+    if (width != 0 && row.length != width) {
+      if (row.has_index()) rowblock::PadNarrow(width - row.length, &index16, &index32, &index);
+      if (row.value != NULL) value.resize(value.size() + width - row.length, 0);
+    }
+    if (width == 0) offset.push_back(this->IndexSize());
   }
   /*!
    * \brief push the row unit block into container
-   * \param row the row to push back
+   * \param batch the unit block to push back
    * \tparam I the index type of the row
    */
   template<typename I, typename D>
-  inline void Push(UnitBlock<I, D> batch, size_t size) {
-    CHECK_EQ(batch.size, size) << "UnitBlock size is not equal to size: "
-                               << batch.size << " vs " << size;
-    size_t ndata = batch.offset[batch.size] - batch.offset[0];
-    index.resize(index.size() + ndata);
-    IndexType *ihead = BeginPtr(index) + offset.back();
-    for (size_t i = 0; i < ndata; ++i) {
-      CHECK_LE(batch.index[i], std::numeric_limits<IndexType>::max())
-          << "index  exceed numeric bound of current type";
-      IndexType findex = static_cast<IndexType>(batch.index[i]);
-      ihead[i] = findex;
-      max_index = std::max(max_index, findex);
+  inline void Push(UnitBlock<I, D> batch) {
+    if (this->Size() == 0) width = batch.width;
+    CHECK_EQ(batch.width, width) << "UnitBlock width does not match container";
+    if (width != 0 && (batch.length != NULL || length.size() != 0)) {
+      if (length.size() == 0) length.resize(this->Size(), width);
+      for (size_t i = 0; i < batch.size; ++i) {
+        length.push_back(batch.length == NULL ? width : batch.length[i]);
+      }
+    }
+    // a sliced block keeps the offsets of its parent
+    size_t begin = width != 0 ? 0 : batch.offset[0];
+    size_t ndata = width != 0 ? batch.size * width
+        : batch.offset[batch.size] - begin;
+    if (batch.index16 != NULL) {
+      this->PushIndex(batch.index16 + begin, ndata, true);
+    } else if (batch.index32 != NULL) {
+      this->PushIndex(batch.index32 + begin, ndata, true);
+    } else if (batch.index != NULL) {
+      this->PushIndex(batch.index + begin, ndata, false);
     }
     if (batch.value != NULL) {
       value.resize(value.size() + ndata);
-      std::memcpy(BeginPtr(value) + value.size() - ndata, batch.value,
+      std::memcpy(BeginPtr(value) + value.size() - ndata, batch.value + begin,
                   ndata * sizeof(DType));
     }
-    size_t shift = offset[size];
+    if (width != 0) return;
+    size_t shift = offset.back();
     offset.resize(offset.size() + batch.size);
-    size_t *ohead = BeginPtr(offset) + size + 1;
-    for (size_t i = 0; i < batch.size; ++i) {
-      ohead[i] = shift + batch.offset[i + 1] - batch.offset[0];
-    }
+    rowblock::RebaseOffsets(batch.offset + 1, batch.size, shift - batch.offset[0],
+                            BeginPtr(offset) + offset.size() - batch.size);
+  }
+  /*! \return bytes taken by the unit block in the binary format */
+  inline size_t SaveBytes(void) const {
+    return sizeof(UnitBlockHeader) + rowblock::ArrayBytes(offset) +
+        rowblock::ArrayBytes(index) + rowblock::ArrayBytes(index16) +
+        rowblock::ArrayBytes(index32) + rowblock::ArrayBytes(value) +
+        rowblock::ArrayBytes(length);
+  }
+  /*!
+   * \brief write the unit block to a binary stream
+   * \param fo output stream
+   */
+  inline void Save(Stream *fo) const {
+    UnitBlockHeader header;
+    header.width = width;
+    header.max_index = max_index;
+    header.types.Set<IndexType, DType>();
+    fo->Write(&header, sizeof(header));
+    rowblock::WriteArray(fo, offset);
+    rowblock::WriteArray(fo, index);
+    rowblock::WriteArray(fo, index16);
+    rowblock::WriteArray(fo, index32);
+    rowblock::WriteArray(fo, value);
+    rowblock::WriteArray(fo, length);
+  }
+  /*!
+   * \brief load unit block from a binary stream
+   * \param fi input stream
+   */
+  inline void Load(Stream *fi) {
+    UnitBlockHeader header;
+    CHECK(fi->Read(&header, sizeof(header)) == sizeof(header)) << "Bad RowBlock format";
+    CHECK((header.types.Check<IndexType, DType>()))
+        << "extra section was written with other index or value types";
+    width = static_cast<size_t>(header.width);
+    max_index = static_cast<IndexType>(header.max_index);
+    CHECK(rowblock::ReadArray(fi, &offset)) << "Bad RowBlock format";
+    CHECK(rowblock::ReadArray(fi, &index)) << "Bad RowBlock format";
+    CHECK(rowblock::ReadArray(fi, &index16)) << "Bad RowBlock format";
+    CHECK(rowblock::ReadArray(fi, &index32)) << "Bad RowBlock format";
+    CHECK(rowblock::ReadArray(fi, &value)) << "Bad RowBlock format";
+    CHECK(rowblock::ReadArray(fi, &length)) << "Bad RowBlock format";
+  }
+  /*!
+   * \brief append the unit block in the compressed format
+   * \param encoder array encoder of the block
+   * \param out output buffer
+   */
+  inline void Encode(codec::ArrayEncoder *encoder, std::string *out) const {
+    UnitBlockHeader header;
+    header.width = width;
+    header.max_index = max_index;
+    header.types.Set<IndexType, DType>();
+    out->append(reinterpret_cast<const char*>(&header), sizeof(header));
+    encoder->Encode(offset, out);
+    encoder->Encode(index, out);
+    encoder->Encode(index16, out);
+    encoder->Encode(index32, out);
+    encoder->Encode(value, out);
+    encoder->Encode(length, out);
+  }
+  /*!
+   * \brief decode unit block in the compressed format
+   * \param p read position, advanced past the unit block
+   * \param end end of the buffer
+   */
+  inline void Decode(const char **p, const char *end) {
+    UnitBlockHeader header;
+    CHECK(static_cast<size_t>(end - *p) >= sizeof(header)) << "Bad RowBlock format";
+    std::memcpy(&header, *p, sizeof(header));
+    *p += sizeof(header);
+    CHECK((header.types.Check<IndexType, DType>()))
+        << "extra section was written with other index or value types";
+    width = static_cast<size_t>(header.width);
+    max_index = static_cast<IndexType>(header.max_index);
+    CHECK(codec::DecodeArray(p, end, &offset)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(p, end, &index)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(p, end, &index16)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(p, end, &index32)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(p, end, &value)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(p, end, &length)) << "Bad RowBlock format";
   }
 };
 
 template<typename IndexType, typename DType>
 inline UnitBlock<IndexType, DType>
 UnitBlockContainer<IndexType, DType>::GetBlock(void) const {
-  // consistency check
-  CHECK_EQ(offset.back(), index.size());
-  CHECK(offset.back() == value.size() || value.size() == 0);
-  UnitBlock<IndexType> data;
-  data.size = offset.size() - 1;
-  data.offset = BeginPtr(offset);
+  UnitBlock<IndexType, DType> data;
+  data.width = width;
+  if (width != 0) {
+    // consistency check
+    const size_t nindex = this->IndexSize();
+    CHECK(nindex % width == 0 && value.size() % width == 0);
+    CHECK(nindex == value.size() || nindex == 0 || value.size() == 0);
+    data.size = this->Size();
+    CHECK(length.size() == 0 || length.size() == data.size);
+    data.offset = NULL;
+    data.length = BeginPtr(length);
+  } else {
+    // consistency check
+    CHECK_EQ(offset.back(), this->IndexSize());
+    CHECK(offset.back() == value.size() || value.size() == 0);
+    data.size = offset.size() - 1;
+    data.offset = BeginPtr(offset);
+    data.length = NULL;
+  }
   data.index = BeginPtr(index);
+  data.index16 = BeginPtr(index16);
+  data.index32 = BeginPtr(index32);
   data.value = BeginPtr(value);
   return data;
 }
@@ -137,8 +616,22 @@ struct RowBlockContainer {
   std::vector<uint64_t> qid;
   /*! \brief field index */
   std::vector<IndexType> field;
+  /*!
+   * \brief field index in one byte, see RowBlock::field8.
+   *  At most one of field, field8 and field16 is not empty.
+   */
+  std::vector<uint8_t> field8;
+  /*! \brief field index in two bytes, see RowBlock::field16 */
+  std::vector<uint16_t> field16;
   /*! \brief feature index */
   std::vector<IndexType> index;
+  /*!
+   * \brief feature index in two bytes, see RowBlock::index16.
+   *  At most one of index, index16 and index32 is not empty.
+   */
+  std::vector<uint16_t> index16;
+  /*! \brief feature index in four bytes, see RowBlock::index32 */
+  std::vector<uint32_t> index32;
   /*! \brief feature value */
   std::vector<DType> value;
   /*! \brief maximum value of field */
@@ -156,13 +649,34 @@ struct RowBlockContainer {
   }
   /*! \brief convert to a row block */
   inline RowBlock<IndexType, DType> GetBlock(void) const;
+  /*! \return bytes taken by the row block in the binary format */
+  inline size_t SaveBytes(void) const {
+    return rowblock::AlignUp(this->DataBytes(), kRowBlockAlign);
+  }
   /*!
-   * \brief write the row block to a binary stream
+   * \brief write the row block to a binary stream,
+   *  including label_width and every extra section
    * \param fo output stream
    */
   inline void Save(Stream *fo) const;
   /*!
-   * \brief load row block from a binary stream
+   * \brief write the row block to a binary stream in the compressed format
+   * \param fo output stream
+   * \param codec_level codec level in [0, codec::kMaxLevel], 0 is the
+   *  plain format written by Save(fo)
+   */
+  inline void Save(Stream *fo, int codec_level) const;
+  /*!
+   * \brief write the row block to a binary stream in the compressed format
+   *  of the encoder's codec level, keep the encoder for the next blocks
+   *  so that its buffers are reused
+   * \param fo output stream
+   * \param encoder the array encoder
+   */
+  inline void Save(Stream *fo, codec::ArrayEncoder *encoder) const;
+  /*!
+   * \brief load row block from a binary stream, either format,
+   *  fails on blocks written by an older format version
    * \param fi output stream
    * \return false if at end of file
    */
@@ -171,6 +685,7 @@ struct RowBlockContainer {
   inline void Clear(void) {
     offset.clear(); offset.push_back(0);
     label.clear(); field.clear(); index.clear(); value.clear(); weight.clear(); qid.clear();
+    field8.clear(); field16.clear(); index16.clear(); index32.clear();
     max_field = 0;
     max_index = 0;
     for (auto it = extra.begin(); it != extra.end(); it++)
@@ -180,17 +695,45 @@ struct RowBlockContainer {
   inline size_t Size(void) const {
     return offset.size() - 1;
   }
+  /*! \return number of stored indices, whatever their width */
+  inline size_t IndexSize(void) const {
+    return index.size() + index16.size() + index32.size();
+  }
+  /*!
+   * \return whether the indices of the rows or of an extra section are
+   *  stored in index16 or index32, see kRowBlockNarrowIndex
+   */
+  inline bool HasNarrowIndex(void) const {
+    bool narrow = index16.size() != 0 || index32.size() != 0;
+    for (size_t i = 0; i < extra.size(); ++i) narrow = narrow || extra[i].HasNarrowIndex();
+    return narrow;
+  }
+  /*!
+   * \brief store the indices of the block, and of every extra section, in
+   *  the narrowest of index16, index32 and index that holds their maximum.
+   *  Later pushes keep the narrow storage while the indices fit.
+   */
+  inline void CompactIndex(void) {
+    rowblock::CompactNarrow(max_index, &index16, &index32, &index);
+    for (size_t i = 0; i < extra.size(); ++i) {
+      extra[i].CompactIndex();
+    }
+  }
   /*! \return estimation of memory cost of this container */
   inline size_t MemCostBytes(void) const {
     size_t total = 0;
     for (auto it = extra.begin(); it != extra.end(); it++)
         total += it->MemCostBytes();
     return total + offset.size() * sizeof(size_t) +
-        label.size() * sizeof(real_t) +
+        label.size() * sizeof(DType) +
         weight.size() * sizeof(real_t) +
         qid.size() * sizeof(size_t) +
         field.size() * sizeof(IndexType) +
+        field8.size() * sizeof(uint8_t) +
+        field16.size() * sizeof(uint16_t) +
         index.size() * sizeof(IndexType) +
+        index16.size() * sizeof(uint16_t) +
+        index32.size() * sizeof(uint32_t) +
         value.size() * sizeof(DType);
   }
   /*!
@@ -200,25 +743,26 @@ struct RowBlockContainer {
    */
   template<typename I>
   inline void Push(Row<I, DType> row) {
+    if (this->Size() == 0) label_width = row.label_width;
+    CHECK_EQ(label_width, row.label_width) << "label_width does not match";
+    if (extra.size() < row.extra.size()) extra.resize(row.extra.size());
     for (size_t i = 0; i < row.label_width; ++i)
       label.push_back(row.label[i]);
     weight.push_back(row.get_weight());
     qid.push_back(row.get_qid());
     if (row.field != NULL) {
-      for (size_t i = 0; i < row.length; ++i) {
-        CHECK_LE(row.field[i], std::numeric_limits<IndexType>::max())
-            << "field exceed numeric bound of current type";
-        IndexType field_id = static_cast<IndexType>(row.field[i]);
-        field.push_back(field_id);
-        max_field = std::max(max_field, field_id);
-    }
+      this->PushField(row.field, row.length, false);
+    } else if (row.field8 != NULL) {
+      this->PushField(row.field8, row.length, true);
+    } else if (row.field16 != NULL) {
+      this->PushField(row.field16, row.length, true);
     }
-    for (size_t i = 0; i < row.length; ++i) {
-      CHECK_LE(row.index[i], std::numeric_limits<IndexType>::max())
-          << "index exceed numeric bound of current type";
-      IndexType findex = static_cast<IndexType>(row.index[i]);
-      index.push_back(findex);
-      max_index = std::max(max_index, findex);
+    if (row.index16 != NULL) {
+      this->PushIndex(row.index16, row.length, true);
+    } else if (row.index32 != NULL) {
+      this->PushIndex(row.index32, row.length, true);
+    } else {
+      this->PushIndex(row.index, row.length, false);
     }
     if (row.value != NULL) {
       for (size_t i = 0; i < row.length; ++i) {
@@ -228,7 +772,7 @@ struct RowBlockContainer {
     for (size_t i = 0; i < row.extra.size(); ++i) {
       extra[i].Push(row.extra[i]);
     }
-    offset.push_back(index.size());
+    offset.push_back(this->IndexSize());
   }
   /*!
    * \brief push the row block into container
@@ -237,52 +781,85 @@ struct RowBlockContainer {
    */
   template<typename I>
   inline void Push(RowBlock<I, DType> batch) {
-    size_t size = label.size();
-    label.resize(label.size() + (batch.size * label_width));
-    std::memcpy(BeginPtr(label) + size, batch.label,
-                (batch.size* label_width) * sizeof(real_t));
+    size_t size = this->Size();
+    if (size == 0) label_width = batch.label_width;
+    CHECK_EQ(label_width, batch.label_width) << "label_width does not match";
+    if (extra.size() < batch.extra.size()) extra.resize(batch.extra.size());
+    label.insert(label.end(), batch.label,
+                 batch.label + batch.size * label_width);
     if (batch.weight != NULL) {
       weight.insert(weight.end(), batch.weight, batch.weight + batch.size);
     }
     if (batch.qid != NULL) {
       qid.insert(qid.end(), batch.qid, batch.qid + batch.size);
     }
-    size_t ndata = batch.offset[batch.size] - batch.offset[0];
+    // a sliced block keeps the offsets of its parent
+    size_t begin = batch.offset[0];
+    size_t ndata = batch.offset[batch.size] - begin;
     if (batch.field != NULL) {
-      field.resize(field.size() + ndata);
-      IndexType *fhead = BeginPtr(field) + offset.back();
-      for (size_t i = 0; i < ndata; ++i) {
-        CHECK_LE(batch.field[i], std::numeric_limits<IndexType>::max())
-            << "field  exceed numeric bound of current type";
-        IndexType field_id = static_cast<IndexType>(batch.field[i]);
-        fhead[i] = field_id;
-        max_field = std::max(max_field, field_id);
-      }
+      this->PushField(batch.field + begin, ndata, false);
+    } else if (batch.field8 != NULL) {
+      this->PushField(batch.field8 + begin, ndata, true);
+    } else if (batch.field16 != NULL) {
+      this->PushField(batch.field16 + begin, ndata, true);
     }
-    index.resize(index.size() + ndata);
-    IndexType *ihead = BeginPtr(index) + offset.back();
-    for (size_t i = 0; i < ndata; ++i) {
-      CHECK_LE(batch.index[i], std::numeric_limits<IndexType>::max())
-          << "index  exceed numeric bound of current type";
-      IndexType findex = static_cast<IndexType>(batch.index[i]);
-      ihead[i] = findex;
-      max_index = std::max(max_index, findex);
+    if (batch.index16 != NULL) {
+      this->PushIndex(batch.index16 + begin, ndata, true);
+    } else if (batch.index32 != NULL) {
+      this->PushIndex(batch.index32 + begin, ndata, true);
+    } else {
+      this->PushIndex(batch.index + begin, ndata, false);
     }
     if (batch.value != NULL) {
       value.resize(value.size() + ndata);
-      std::memcpy(BeginPtr(value) + value.size() - ndata, batch.value,
+      std::memcpy(BeginPtr(value) + value.size() - ndata, batch.value + begin,
                   ndata * sizeof(DType));
     }
     size_t shift = offset[size];
     offset.resize(offset.size() + batch.size);
-    size_t *ohead = BeginPtr(offset) + size + 1;
-    for (size_t i = 0; i < batch.size; ++i) {
-      ohead[i] = shift + batch.offset[i + 1] - batch.offset[0];
-    }
+    rowblock::RebaseOffsets(batch.offset + 1, batch.size, shift - batch.offset[0],
+                            BeginPtr(offset) + size + 1);
     for (size_t i = 0; i < batch.extra.size(); ++i) {
-      extra[i].Push(batch.extra[i], size);
+      CHECK_EQ(batch.extra[i].size, batch.size) << "extra section size mismatch";
+      extra[i].Push(batch.extra[i]);
     }
   }
+  /*!
+   * \brief append field ids, see rowblock::PushNarrow
+   * \param src the field ids
+   * \param n number of ids
+   * \param narrow whether src is field8 or field16 storage
+   */
+  template<typename F>
+  inline void PushField(const F *src, size_t n, bool narrow) {
+    max_field = std::max(max_field, static_cast<IndexType>(
+        rowblock::PushNarrow(src, n, narrow, &field8, &field16, &field)));
+  }
+  /*!
+   * \brief append feature indices, see rowblock::PushNarrow
+   * \param src the indices
+   * \param n number of indices
+   * \param narrow whether src is index16 or index32 storage
+   */
+  template<typename I>
+  inline void PushIndex(const I *src, size_t n, bool narrow) {
+    max_index = std::max(max_index, static_cast<IndexType>(
+        rowblock::PushNarrow(src, n, narrow, &index16, &index32, &index)));
+  }
+  /*! \return bytes of the binary format before the block padding */
+  inline size_t DataBytes(void) const {
+    size_t nbytes = sizeof(RowBlockHeader) +
+        rowblock::ArrayBytes(offset) + rowblock::ArrayBytes(label) +
+        rowblock::ArrayBytes(weight) + rowblock::ArrayBytes(qid) +
+        rowblock::ArrayBytes(field) + rowblock::ArrayBytes(field8) +
+        rowblock::ArrayBytes(field16) + rowblock::ArrayBytes(index) +
+        rowblock::ArrayBytes(index16) + rowblock::ArrayBytes(index32) +
+        rowblock::ArrayBytes(value);
+    for (size_t i = 0; i < extra.size(); ++i) {
+      nbytes += extra[i].SaveBytes();
+    }
+    return nbytes;
+  }
 };
 
 template<typename IndexType, typename DType>
@@ -292,7 +869,7 @@ RowBlockContainer<IndexType, DType>::GetBlock(void) const {
   if (label.size()) {
     CHECK_EQ((label.size() / label_width) + 1, offset.size());
   }
-  CHECK_EQ(offset.back(), index.size());
+  CHECK_EQ(offset.back(), this->IndexSize());
   CHECK(offset.back() == value.size() || value.size() == 0);
   RowBlock<IndexType, DType> data;
   data.label_width = label_width;
@@ -302,40 +879,183 @@ RowBlockContainer<IndexType, DType>::GetBlock(void) const {
   data.weight = BeginPtr(weight);
   data.qid = BeginPtr(qid);
   data.field = BeginPtr(field);
+  data.field8 = BeginPtr(field8);
+  data.field16 = BeginPtr(field16);
   data.index = BeginPtr(index);
+  data.index16 = BeginPtr(index16);
+  data.index32 = BeginPtr(index32);
   data.value = BeginPtr(value);
   data.extra.resize(extra.size());
-  for (int i = 0; i < extra.size(); ++i)
+  for (size_t i = 0; i < extra.size(); ++i)
     data.extra[i] = extra[i].GetBlock();
   return data;
 }
 template<typename IndexType, typename DType>
 inline void
 RowBlockContainer<IndexType, DType>::Save(Stream *fo) const {
-  fo->Write(offset);
-  fo->Write(label);
-  fo->Write(weight);
-  fo->Write(qid);
-  fo->Write(field);
-  fo->Write(index);
-  fo->Write(value);
-  fo->Write(&max_field, sizeof(IndexType));
-  fo->Write(&max_index, sizeof(IndexType));
+  RowBlockHeader header;
+  header.magic = kRowBlockMagic;
+  header.version = kRowBlockVersion;
+  header.flags = this->HasNarrowIndex() ? kRowBlockNarrowIndex : 0;
+  header.nbytes = this->SaveBytes();
+  header.label_width = label_width;
+  header.max_field = max_field;
+  header.max_index = max_index;
+  header.num_extra = extra.size();
+  header.types.Set<IndexType, DType>();
+  fo->Write(&header, sizeof(header));
+  rowblock::WriteArray(fo, offset);
+  rowblock::WriteArray(fo, label);
+  rowblock::WriteArray(fo, weight);
+  rowblock::WriteArray(fo, qid);
+  rowblock::WriteArray(fo, field);
+  rowblock::WriteArray(fo, field8);
+  rowblock::WriteArray(fo, field16);
+  rowblock::WriteArray(fo, index);
+  rowblock::WriteArray(fo, index16);
+  rowblock::WriteArray(fo, index32);
+  rowblock::WriteArray(fo, value);
+  for (size_t i = 0; i < extra.size(); ++i) {
+    extra[i].Save(fo);
+  }
+  rowblock::WritePadding(fo, header.nbytes - this->DataBytes());
+}
+template<typename IndexType, typename DType>
+inline void
+RowBlockContainer<IndexType, DType>::Save(Stream *fo, int codec_level) const {
+  CHECK(codec_level >= 0 && codec_level <= codec::kMaxLevel)
+      << "codec level must be in [0, " << codec::kMaxLevel << "]";
+  codec::ArrayEncoder encoder(codec_level);
+  this->Save(fo, &encoder);
+}
+template<typename IndexType, typename DType>
+inline void
+RowBlockContainer<IndexType, DType>::Save(Stream *fo, codec::ArrayEncoder *encoder) const {
+  if (encoder->level() == 0) {
+    this->Save(fo);
+    return;
+  }
+  // no array encodes larger than raw, leave room for the array headers
+  std::string buf;
+  buf.reserve(this->MemCostBytes() + 4096);
+  encoder->Encode(offset, &buf);
+  encoder->Encode(label, &buf);
+  encoder->Encode(weight, &buf);
+  encoder->Encode(qid, &buf);
+  encoder->Encode(field, &buf);
+  encoder->Encode(field8, &buf);
+  encoder->Encode(field16, &buf);
+  encoder->Encode(index, &buf);
+  encoder->Encode(index16, &buf);
+  encoder->Encode(index32, &buf);
+  encoder->Encode(value, &buf);
+  for (size_t i = 0; i < extra.size(); ++i) {
+    extra[i].Encode(encoder, &buf);
+  }
+  RowBlockHeader header;
+  header.magic = kRowBlockMagic;
+  header.version = kRowBlockVersion;
+  header.flags = kRowBlockCompressed | (this->HasNarrowIndex() ? kRowBlockNarrowIndex : 0);
+  header.nbytes = sizeof(header) + buf.size();
+  header.label_width = label_width;
+  header.max_field = max_field;
+  header.max_index = max_index;
+  header.num_extra = extra.size();
+  header.types.Set<IndexType, DType>();
+  fo->Write(&header, sizeof(header));
+  fo->Write(buf.data(), buf.size());
 }
 template<typename IndexType, typename DType>
 inline bool
 RowBlockContainer<IndexType, DType>::Load(Stream *fi) {
-  if (!fi->Read(&offset)) return false;
-  CHECK(fi->Read(&label)) << "Bad RowBlock format";
-  CHECK(fi->Read(&weight)) << "Bad RowBlock format";
-  CHECK(fi->Read(&qid)) << "Bad RowBlock format";
-  CHECK(fi->Read(&field)) << "Bad RowBlock format";
-  CHECK(fi->Read(&index)) << "Bad RowBlock format";
-  CHECK(fi->Read(&value)) << "Bad RowBlock format";
-  CHECK(fi->Read(&max_field, sizeof(IndexType))) << "Bad RowBlock format";
-  CHECK(fi->Read(&max_index, sizeof(IndexType))) << "Bad RowBlock format";
+  RowBlockHeader header;
+  size_t nread = fi->Read(&header, sizeof(header));
+  if (nread == 0) return false;
+  CHECK(nread == sizeof(header) && header.magic == kRowBlockMagic)
+      << "Bad RowBlock format: the data was written by an older version "
+      << "without extra sections and label_width, remove the cache file to rebuild it";
+  CHECK_EQ(header.version, kRowBlockVersion)
+      << "Unsupported RowBlock format version, remove the cache file to rebuild it";
+  CHECK((header.types.Check<IndexType, DType>()))
+      << "RowBlock was written with " << header.types.index_bytes
+      << " byte indices and value type " << header.types.dtype << ", not the " << sizeof(IndexType) << " byte indices and value type "
+      << RowBlockDType<DType>::kCode << " of the reader, remove the cache file to rebuild it";
+  label_width = static_cast<size_t>(header.label_width);
+  max_field = static_cast<IndexType>(header.max_field);
+  max_index = static_cast<IndexType>(header.max_index);
+  extra.resize(static_cast<size_t>(header.num_extra));
+  if (header.flags & kRowBlockCompressed) {
+    CHECK_GE(header.nbytes, sizeof(header)) << "Bad RowBlock format";
+    std::string buf(static_cast<size_t>(header.nbytes) - sizeof(header), '\0');
+    CHECK(fi->Read(&buf[0], buf.size()) == buf.size()) << "Bad RowBlock format";
+    const char *p = buf.data();
+    const char *end = p + buf.size();
+    CHECK(codec::DecodeArray(&p, end, &offset)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(&p, end, &label)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(&p, end, &weight)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(&p, end, &qid)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(&p, end, &field)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(&p, end, &field8)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(&p, end, &field16)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(&p, end, &index)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(&p, end, &index16)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(&p, end, &index32)) << "Bad RowBlock format";
+    CHECK(codec::DecodeArray(&p, end, &value)) << "Bad RowBlock format";
+    for (size_t i = 0; i < extra.size(); ++i) {
+      extra[i].Decode(&p, end);
+    }
+    CHECK(p == end) << "Bad RowBlock format";
+    CHECK_EQ(this->HasNarrowIndex(), (header.flags & kRowBlockNarrowIndex) != 0)
+        << "Bad RowBlock format";
+    return true;
+  }
+  CHECK(rowblock::ReadArray(fi, &offset)) << "Bad RowBlock format";
+  CHECK(rowblock::ReadArray(fi, &label)) << "Bad RowBlock format";
+  CHECK(rowblock::ReadArray(fi, &weight)) << "Bad RowBlock format";
+  CHECK(rowblock::ReadArray(fi, &qid)) << "Bad RowBlock format";
+  CHECK(rowblock::ReadArray(fi, &field)) << "Bad RowBlock format";
+  CHECK(rowblock::ReadArray(fi, &field8)) << "Bad RowBlock format";
+  CHECK(rowblock::ReadArray(fi, &field16)) << "Bad RowBlock format";
+  CHECK(rowblock::ReadArray(fi, &index)) << "Bad RowBlock format";
+  CHECK(rowblock::ReadArray(fi, &index16)) << "Bad RowBlock format";
+  CHECK(rowblock::ReadArray(fi, &index32)) << "Bad RowBlock format";
+  CHECK(rowblock::ReadArray(fi, &value)) << "Bad RowBlock format";
+  for (size_t i = 0; i < extra.size(); ++i) {
+    extra[i].Load(fi);
+  }
+  size_t nbytes = this->DataBytes();
+  CHECK(header.nbytes >= nbytes &&
+        rowblock::SkipBytes(fi, static_cast<size_t>(header.nbytes) - nbytes))
+      << "Bad RowBlock format";
+  CHECK_EQ(this->HasNarrowIndex(), (header.flags & kRowBlockNarrowIndex) != 0)
+      << "Bad RowBlock format";
   return true;
 }
+
+/*!
+ * \brief write every row of the parser to a binary cache file,
+ *  in blocks of about kRowBlockCacheBytes
+ * \param parser the parser, read until the end
+ * \param cache_file the cache file
+ * \param codec_level codec level of the cache, see RowBlockContainer::Save
+ */
+template<typename IndexType, typename DType>
+inline void BuildRowBlockCache(Parser<IndexType, DType> *parser,
+                               const char *cache_file,
+                               int codec_level) {
+  Stream *fo = Stream::Create(cache_file, "w");
+  RowBlockContainer<IndexType, DType> data;
+  codec::ArrayEncoder encoder(codec_level);
+  while (parser->Next()) {
+    data.Push(parser->Value());
+    if (data.MemCostBytes() >= kRowBlockCacheBytes) {
+      data.Save(fo, &encoder);
+      data.Clear();
+    }
+  }
+  if (data.Size() != 0) data.Save(fo, &encoder);
+  delete fo;
+}
 }  // namespace data
 }  // namespace dmlc
 #endif  // DMLC_DATA_ROW_BLOCK_H_
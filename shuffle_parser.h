@@ -0,0 +1,262 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file shuffle_parser.h
+ * \brief parser adaptor that shuffles rows within a bounded memory buffer
+ */
+#ifndef DMLC_DATA_SHUFFLE_PARSER_H_
+#define DMLC_DATA_SHUFFLE_PARSER_H_
+
+#include <dmlc/base.h>
+#include <dmlc/data.h>
+#include <dmlc/logging.h>
+#include <dmlc/threadediter.h>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <utility>
+#include <vector>
+#include "./row_block.h"
+
+namespace dmlc {
+namespace data {
+/*!
+ * \brief shuffles the rows of the wrapped parser, with every extra section,
+ *  inside a buffer of about buffer_bytes. Each fill is built next to the
+ *  previous one, so up to twice the budget stays allocated.
+ *  The buffer is filled with blocks of the wrapped parser and permuted,
+ *  then half of it is emitted and the other half is carried over into the
+ *  next fill, so rows also mix across buffer boundaries. Filling,
+ *  permuting and copying run in a background thread.
+ *  The order is a function of the seed and the epoch only: epoch k,
+ *  counted by BeforeFirst, always yields the same order.
+ * \tparam IndexType type of index in RowBlock
+ * \tparam DType type of label and value in RowBlock
+ */
+template <typename IndexType, typename DType = real_t>
+class ShuffleParser : public Parser<IndexType, DType> {
+ public:
+  /*!
+   * \brief constructor
+   * \param base the parser to shuffle, owned by this parser
+   * \param buffer_bytes memory budget of the shuffle buffer
+   * \param seed the random seed
+   */
+  ShuffleParser(Parser<IndexType, DType> *base, size_t buffer_bytes, uint64_t seed)
+      : base_(base), buffer_bytes_(buffer_bytes), seed_(seed), epoch_(0),
+        iter_(kQueueBlocks), out_(NULL) {
+    CHECK_NE(buffer_bytes, 0U) << "shuffle buffer must not be empty";
+    this->Reset();
+    iter_.Init([this](RowBlockContainer<IndexType, DType> **dptr) {
+        if (*dptr == NULL) {
+          *dptr = new RowBlockContainer<IndexType, DType>();
+        }
+        return this->FillBlock(*dptr);
+      },
+      [this]() {
+        ++epoch_;
+        base_->BeforeFirst();
+        this->Reset();
+      });
+  }
+  virtual ~ShuffleParser(void) {
+    iter_.Destroy();
+    delete base_;
+  }
+  virtual void BeforeFirst(void) {
+    if (out_ != NULL) iter_.Recycle(&out_);
+    iter_.BeforeFirst();
+  }
+  virtual bool Next(void) {
+    if (out_ != NULL) iter_.Recycle(&out_);
+    if (!iter_.Next(&out_)) return false;
+    block_ = out_->GetBlock();
+    return true;
+  }
+  virtual const RowBlock<IndexType, DType> &Value(void) const {
+    return block_;
+  }
+  virtual size_t BytesRead(void) const {
+    return bytes_read_.load(std::memory_order_relaxed);
+  }
+  virtual const DataStats *Stats(void) {
+    // base_ runs in the thread of iter_, the collectors may be read from any thread
+    return base_->Stats();
+  }
+
+ private:
+  /*! \brief shuffled blocks prepared ahead of the consumer */
+  static const size_t kQueueBlocks = 4;
+  /*! \brief the wrapped parser */
+  Parser<IndexType, DType> *base_;
+  /*! \brief memory budget of the buffer */
+  size_t buffer_bytes_;
+  /*! \brief the random seed */
+  uint64_t seed_;
+  /*! \brief number of BeforeFirst calls */
+  uint64_t epoch_;
+  /*! \brief random generator of the current epoch */
+  std::mt19937_64 rng_;
+  /*! \brief whether base_ reached its end in this epoch */
+  bool eof_;
+  /*! \brief rows of an emitted block, the largest block of base_ */
+  size_t block_rows_;
+  /*! \brief the rows in the buffer */
+  RowBlockContainer<IndexType, DType> window_;
+  /*! \brief the next fill of the buffer */
+  RowBlockContainer<IndexType, DType> next_;
+  /*! \brief view of window_ */
+  RowBlock<IndexType, DType> view_;
+  /*! \brief BytesRead of base_, read by the producer, which owns base_ */
+  std::atomic<size_t> bytes_read_;
+  /*! \brief permutation of the rows of window_ */
+  std::vector<size_t> perm_;
+  /*! \brief next position in perm_ to emit */
+  size_t pos_;
+  /*! \brief position in perm_ at which the buffer is refilled */
+  size_t refill_;
+  /*! \brief background producer of shuffled blocks */
+  ThreadedIter<RowBlockContainer<IndexType, DType> > iter_;
+  /*! \brief block held by the consumer */
+  RowBlockContainer<IndexType, DType> *out_;
+  /*! \brief the current block */
+  RowBlock<IndexType, DType> block_;
+  /*! \brief start a new epoch, called in the producer thread */
+  inline void Reset(void) {
+    // golden ratio step so that neighbouring epochs get unrelated streams
+    rng_.seed(seed_ + epoch_ * 0x9e3779b97f4a7c15ULL);
+    eof_ = false;
+    block_rows_ = 0;
+    window_.Clear();
+    next_.Clear();
+    perm_.clear();
+    pos_ = refill_ = 0;
+    bytes_read_.store(base_->BytesRead(), std::memory_order_relaxed);
+  }
+  /*! \brief append src[r * width, (r + 1) * width) of the rows r to dst */
+  template<typename T>
+  inline static void GatherFixed(const T *src, size_t width, const size_t *rows, size_t n,
+                                 std::vector<T> *dst) {
+    if (src == NULL) return;
+    size_t pos = dst->size();
+    dst->resize(pos + n * width);
+    T *out = BeginPtr(*dst) + pos;
+    for (size_t i = 0; i < n; ++i, out += width) {
+      std::copy(src + rows[i] * width, src + (rows[i] + 1) * width, out);
+    }
+  }
+  /*! \brief append src[offset[r], offset[r + 1]) of the rows r to dst */
+  template<typename T>
+  inline static void GatherRanges(const T *src, const size_t *offset, const size_t *rows,
+                                  size_t n, size_t nelem, std::vector<T> *dst) {
+    if (src == NULL) return;
+    size_t pos = dst->size();
+    dst->resize(pos + nelem);
+    T *out = BeginPtr(*dst) + pos;
+    for (size_t i = 0; i < n; ++i) {
+      out = std::copy(src + offset[rows[i]], src + offset[rows[i] + 1], out);
+    }
+  }
+  /*!
+   * \brief copy the rows of view_ into the empty container out, every array
+   *  is copied a row range at a time into storage of the width view_ uses
+   * \param rows the rows of view_
+   * \param n number of rows
+   * \param out the output, must be empty
+   */
+  inline void PushRows(const size_t *rows, size_t n, RowBlockContainer<IndexType, DType> *out) {
+    const RowBlock<IndexType, DType> &v = view_;
+    out->label_width = v.label_width;
+    GatherFixed(v.label, v.label_width, rows, n, &out->label);
+    GatherFixed(v.weight, 1, rows, n, &out->weight);
+    GatherFixed(v.qid, 1, rows, n, &out->qid);
+    out->offset.resize(n + 1);
+    for (size_t i = 0; i < n; ++i) {
+      out->offset[i + 1] = out->offset[i] + v.offset[rows[i] + 1] - v.offset[rows[i]];
+    }
+    const size_t nelem = out->offset[n];
+    GatherRanges(v.field, v.offset, rows, n, nelem, &out->field);
+    GatherRanges(v.field8, v.offset, rows, n, nelem, &out->field8);
+    GatherRanges(v.field16, v.offset, rows, n, nelem, &out->field16);
+    GatherRanges(v.index, v.offset, rows, n, nelem, &out->index);
+    GatherRanges(v.index16, v.offset, rows, n, nelem, &out->index16);
+    GatherRanges(v.index32, v.offset, rows, n, nelem, &out->index32);
+    GatherRanges(v.value, v.offset, rows, n, nelem, &out->value);
+    out->max_field = static_cast<IndexType>(std::max<uint64_t>(std::max<uint64_t>(
+        rowblock::MaxValue(BeginPtr(out->field), out->field.size()),
+        rowblock::MaxValue(BeginPtr(out->field8), out->field8.size())),
+        rowblock::MaxValue(BeginPtr(out->field16), out->field16.size())));
+    out->max_index = MaxIndex(*out);
+    out->extra.resize(v.extra.size());
+    for (size_t k = 0; k < v.extra.size(); ++k) {
+      const UnitBlock<IndexType> &u = v.extra[k];
+      UnitBlockContainer<IndexType> *e = &out->extra[k];
+      e->width = u.width;
+      if (u.width != 0) {
+        GatherFixed(u.length, 1, rows, n, &e->length);
+        GatherFixed(u.index, u.width, rows, n, &e->index);
+        GatherFixed(u.index16, u.width, rows, n, &e->index16);
+        GatherFixed(u.index32, u.width, rows, n, &e->index32);
+        GatherFixed(u.value, u.width, rows, n, &e->value);
+      } else {
+        e->offset.resize(n + 1);
+        for (size_t i = 0; i < n; ++i) {
+          e->offset[i + 1] = e->offset[i] + u.offset[rows[i] + 1] - u.offset[rows[i]];
+        }
+        const size_t nunit = e->offset[n];
+        GatherRanges(u.index, u.offset, rows, n, nunit, &e->index);
+        GatherRanges(u.index16, u.offset, rows, n, nunit, &e->index16);
+        GatherRanges(u.index32, u.offset, rows, n, nunit, &e->index32);
+        GatherRanges(u.value, u.offset, rows, n, nunit, &e->value);
+      }
+      e->max_index = MaxIndex(*e);
+    }
+  }
+  /*! \return largest index of a container, whichever storage holds it */
+  template<typename C>
+  inline static IndexType MaxIndex(const C &c) {
+    return static_cast<IndexType>(std::max<uint64_t>(std::max<uint64_t>(
+        rowblock::MaxValue(BeginPtr(c.index), c.index.size()),
+        rowblock::MaxValue(BeginPtr(c.index16), c.index16.size())),
+        rowblock::MaxValue(BeginPtr(c.index32), c.index32.size())));
+  }
+  /*! \brief carry the rows not emitted yet over and refill the buffer */
+  inline bool FillWindow(void) {
+    next_.Clear();
+    this->PushRows(BeginPtr(perm_) + pos_, perm_.size() - pos_, &next_);
+    while (!eof_ && next_.MemCostBytes() < buffer_bytes_) {
+      if (!base_->Next()) {
+        eof_ = true;
+        break;
+      }
+      bytes_read_.store(base_->BytesRead(), std::memory_order_relaxed);
+      const RowBlock<IndexType, DType> &batch = base_->Value();
+      if (batch.size == 0) continue;
+      block_rows_ = std::max(block_rows_, batch.size);
+      next_.Push(batch);
+    }
+    std::swap(window_, next_);
+    perm_.resize(window_.Size());
+    pos_ = 0;
+    if (perm_.size() == 0) return false;
+    view_ = window_.GetBlock();
+    // Fisher-Yates, the draws do not depend on the standard library
+    for (size_t i = 0; i < perm_.size(); ++i) perm_[i] = i;
+    for (size_t i = perm_.size() - 1; i > 0; --i) {
+      std::swap(perm_[i], perm_[static_cast<size_t>(rng_() % (i + 1))]);
+    }
+    refill_ = eof_ ? perm_.size() : std::max<size_t>(perm_.size() / 2, 1);
+    return true;
+  }
+  /*! \brief produce the next shuffled block, called in the producer thread */
+  inline bool FillBlock(RowBlockContainer<IndexType, DType> *out) {
+    if (pos_ == refill_ && !this->FillWindow()) return false;
+    out->Clear();
+    size_t end = std::min(refill_, pos_ + block_rows_);
+    this->PushRows(BeginPtr(perm_) + pos_, end - pos_, out);
+    pos_ = end;
+    return true;
+  }
+};
+}  // namespace data
+}  // namespace dmlc
+#endif  // DMLC_DATA_SHUFFLE_PARSER_H_
@@ -0,0 +1,133 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file text_scanner.h
+ * \brief single pass structural scanner for delimited text blocks,
+ *  locates line ends and delimiters of a whole chunk at once so that
+ *  the field parsers do not need to rescan the text byte by byte
+ */
+#ifndef DMLC_DATA_TEXT_SCANNER_H_
+#define DMLC_DATA_TEXT_SCANNER_H_
+
+#include <dmlc/base.h>
+#include <dmlc/logging.h>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace dmlc {
+namespace data {
+namespace scanner {
+/*! \return index of the lowest set bit, mask must not be zero */
+inline int LowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanForward(&idx, mask);
+  return static_cast<int>(idx);
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+/*! \brief append base + position of every set bit in mask */
+inline void EmitBits(uint32_t mask, uint32_t base, std::vector<uint32_t> *out) {
+  while (mask != 0) {
+    out->push_back(base + LowestBit(mask));
+    mask &= mask - 1;
+  }
+}
+}  // namespace scanner
+
+/*!
+ * \brief scan [begin, end) once and record the offset (relative to begin)
+ *  of every structural character, i.e. '\n', '\r', D0, D1 and D2.
+ *  The offsets are appended to out in increasing order.
+ *
+ *  The scan is vectorized with AVX2 or SSE2 when the compiler targets them,
+ *  and falls back to a scalar loop otherwise.
+ * \param begin beginning of the text
+ * \param end end of the text
+ * \param out the output position index, cleared before scanning
+ * \tparam D0 first delimiter
+ * \tparam D1 second delimiter
+ * \tparam D2 third delimiter, repeat a delimiter if fewer are needed
+ */
+template<char D0, char D1, char D2>
+inline void ScanStructure(const char *begin, const char *end,
+                          std::vector<uint32_t> *out) {
+  out->clear();
+  const size_t nbytes = end - begin;
+  CHECK_LE(nbytes, static_cast<size_t>(std::numeric_limits<uint32_t>::max()))
+      << "text block too large for structural index";
+  size_t i = 0;
+#if defined(__AVX2__)
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i d0 = _mm256_set1_epi8(D0);
+  const __m256i d1 = _mm256_set1_epi8(D1);
+  const __m256i d2 = _mm256_set1_epi8(D2);
+  for (; i + 32 <= nbytes; i += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin + i));
+    __m256i m = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, d0),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, d1),
+                                        _mm256_cmpeq_epi8(v, d2))));
+    scanner::EmitBits(static_cast<uint32_t>(_mm256_movemask_epi8(m)),
+                      static_cast<uint32_t>(i), out);
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  const __m128i lf = _mm_set1_epi8('\n');
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i d0 = _mm_set1_epi8(D0);
+  const __m128i d1 = _mm_set1_epi8(D1);
+  const __m128i d2 = _mm_set1_epi8(D2);
+  for (; i + 16 <= nbytes; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin + i));
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)),
+        _mm_or_si128(_mm_cmpeq_epi8(v, d0),
+                     _mm_or_si128(_mm_cmpeq_epi8(v, d1),
+                                  _mm_cmpeq_epi8(v, d2))));
+    scanner::EmitBits(static_cast<uint32_t>(_mm_movemask_epi8(m)),
+                      static_cast<uint32_t>(i), out);
+  }
+#endif
+  for (; i < nbytes; ++i) {
+    char c = begin[i];
+    if (c == '\n' || c == '\r' || c == D0 || c == D1 || c == D2) {
+      out->push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+/*!
+ * \brief visit every token of the section [sbegin, send) of a scanned text
+ * \param text the text that was passed to ScanStructure
+ * \param sbegin offset of the section begin
+ * \param send offset of the section end
+ * \param dfirst first delimiter position inside the section
+ * \param dlast one past the last delimiter position inside the section
+ * \param fn called as fn(token_begin, token_end, delim), where delim is the
+ *  character terminating the token, or '\0' for the last token.
+ *  Empty tokens are visited as well.
+ */
+template<typename Fn>
+inline void ForEachToken(const char *text, uint32_t sbegin, uint32_t send,
+                         const uint32_t *dfirst, const uint32_t *dlast,
+                         Fn fn) {
+  uint32_t tbegin = sbegin;
+  for (const uint32_t *it = dfirst; it != dlast; ++it) {
+    fn(text + tbegin, text + *it, text[*it]);
+    tbegin = *it + 1;
+  }
+  fn(text + tbegin, text + send, '\0');
+}
+}  // namespace data
+}  // namespace dmlc
+#endif  // DMLC_DATA_TEXT_SCANNER_H_
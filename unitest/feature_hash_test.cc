@@ -0,0 +1,112 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file feature_hash_test.cc
+ * \brief checks the hashed features of the libsvm and rmf parsers
+ *  (hash_features=1) on lines that mix key only tokens such as
+ *  "country:us" with valued tokens such as "price:3.5": every feature
+ *  must keep its own value, key only tokens count as 1. Also checks that
+ *  hash_keys_only=1 hashes "uid:12345" as a whole key.
+ *
+ *  Build against dmlc-core, e.g.
+ *    g++ -std=c++11 -O2 -fopenmp -I3rdparty/dmlc-core/include -I3rdparty/dmlc-core/src \
+ *        unitest/feature_hash_test.cc 3rdparty/dmlc-core/libdmlc.a -lpthread -o feature_hash_test
+ *  Usage:
+ *    feature_hash_test [scratch_dir=/tmp]
+ *  prints one line per case and exits with 1 if any case fails.
+ */
+#include <dmlc/data.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "data/feature_hash.h"
+
+namespace {
+/*! \brief an expected feature, the token is hashed with the salt */
+struct Feature {
+  const char *key;
+  float value;
+};
+
+/*! \brief write text to path */
+void WriteFile(const std::string &path, const std::string &text) {
+  FILE *fp = std::fopen(path.c_str(), "wb");
+  CHECK(fp != NULL) << "cannot write " << path;
+  std::fwrite(text.data(), 1, text.length(), fp);
+  std::fclose(fp);
+}
+
+/*! \return whether the row is the features of expect, in order */
+template<typename Row>
+bool SameRow(const Row &row, const std::vector<Feature> &expect, uint64_t salt) {
+  dmlc::data::FeatureHasher<uint32_t> hasher;
+  hasher.Init(0, 0);
+  if (row.length != expect.size()) return false;
+  for (size_t i = 0; i < expect.size(); ++i) {
+    const char *key = expect[i].key;
+    if (row.get_index(i) != hasher.Hash(key, key + std::strlen(key), salt)) return false;
+    if (row.get_value(i) != expect[i].value) return false;
+  }
+  return true;
+}
+
+/*! \return number of failed cases, every row of the parsed uri against rows */
+int Check(const char *name, const std::string &uri, const char *format,
+          const std::vector<std::vector<Feature> > &rows) {
+  dmlc::Parser<uint32_t> *parser = dmlc::Parser<uint32_t>::Create(uri.c_str(), 0, 1, format);
+  size_t n = 0;
+  bool ok = true;
+  while (parser->Next()) {
+    const dmlc::RowBlock<uint32_t> &block = parser->Value();
+    for (size_t i = 0; i < block.size; ++i, ++n) {
+      if (n >= rows.size()) {
+        ok = false;
+      } else if (block.extra.size() != 0) {
+        // rmf, the hashed tokens are in the sparse section, salted with 2
+        ok = ok && SameRow(block.extra[2][i], rows[n], 2);
+      } else {
+        ok = ok && SameRow(block[i], rows[n], 0);
+      }
+    }
+  }
+  delete parser;
+  ok = ok && n == rows.size();
+  std::printf("%-24s %s\n", name, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  const std::string dir = argc > 1 ? argv[1] : "/tmp";
+  int failed = 0;
+  // the first valued token of a block comes after key only tokens, also of earlier lines
+  const std::vector<std::vector<Feature> > mixed = {
+    {{"country:us", 1.0f}, {"os=linux", 1.0f}},
+    {{"country:de", 1.0f}, {"price", 3.5f}, {"city:sf", 1.0f}, {"w", 2.0f}},
+    {{"country:fr", 1.0f}}
+  };
+  WriteFile(dir + "/feature_hash_test.svm",
+            "0 country:us os=linux\n"
+            "1 country:de price:3.5 city:sf w:2\n"
+            "0 country:fr\n");
+  failed += Check("libsvm mixed", dir + "/feature_hash_test.svm?hash_features=1",
+                  "libsvm", mixed);
+  WriteFile(dir + "/feature_hash_test.rmf",
+            "0 1\0010.5\0011\0011 2\001country:us os=linux\n"
+            "1 0\0010.5\0011\0011 2\001country:de price:3.5 city:sf w:2\n"
+            "0 0\0010.5\0011\0011 2\001country:fr\n");
+  failed += Check("rmf mixed", dir + "/feature_hash_test.rmf?hash_features=1"
+                  "&multi_field_num=2&label_width=2", "rmf", mixed);
+  // raw ids keep their number in the key
+  const std::vector<std::vector<Feature> > keys = {
+    {{"uid:12345", 1.0f}, {"uid:777", 1.0f}, {"price:3.5", 1.0f}}
+  };
+  WriteFile(dir + "/feature_hash_test_keys.svm", "1 uid:12345 uid:777 price:3.5\n");
+  failed += Check("libsvm hash_keys_only", dir + "/feature_hash_test_keys.svm"
+                  "?hash_features=1&hash_keys_only=1", "libsvm", keys);
+  std::remove((dir + "/feature_hash_test.svm").c_str());
+  std::remove((dir + "/feature_hash_test.rmf").c_str());
+  std::remove((dir + "/feature_hash_test_keys.svm").c_str());
+  std::printf("%d failed\n", failed);
+  return failed == 0 ? 0 : 1;
+}
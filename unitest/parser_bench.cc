@@ -0,0 +1,874 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file parser_bench.cc
+ * \brief throughput benchmark of the registered text parsers.
+ *
+ *  Generates synthetic libsvm, libfm, csv and rmf corpora, optionally adds
+ *  an existing rmf file such as unitest/part, and reports per stage timing
+ *  for every format and thread count:
+ *    read   raw InputSplit chunk reading, the I/O bound of the parsers
+ *    parse  Parser::Create + Parser::Next, also MB/s, rows/s, allocations
+ *    touch  a consumer pass over every row of the parsed blocks
+ *    steady a second parse pass after BeforeFirst, once every scratch and
+ *           output buffer has reached its size; fails if the records
+ *           still allocate, see kMaxSteadyAllocPerBlock
+ *    build  parse and write a binary row block cache
+ *    replay read the binary row block cache back
+ *    slice  cut every parsed block into minibatches of batch rows with
+ *           RowBlock::Slice, the first pass checks every sliced row
+ *    append concatenate the parsed blocks with RowBlockContainer::Push,
+ *           as BasicRowIter does, into a container that already has the
+ *           capacity, MB/s counts the appended bytes
+ *    widen  the same into a container of 64 bit indices
+ *    encodeN / decodeN
+ *           RowBlockContainer::Save / Load of the parsed blocks to memory
+ *           with one codec::ArrayEncoder of cache codec level N, MB/s
+ *           counts the in-memory bytes, ratio is in-memory over encoded
+ *           bytes; the first pass checks that every block decodes to what
+ *           was encoded
+ *
+ *  and, once before the corpora, the token decoders of decimal.h:
+ *    strtof / decimal   decode float tokens with strtof / ParseDecimalFloat
+ *    strtoull / uint    decode integer tokens with strtoull / ParseDecimalUInt
+ *  after a sweep that checks both decoders bit for bit against the C
+ *  library on exponents, long mantissas, slow path and malformed tokens.
+ *
+ *  Build against dmlc-core, e.g.
+ *    g++ -std=c++11 -O3 -fopenmp -I3rdparty/dmlc-core/include -I3rdparty/dmlc-core/src \
+ *        unitest/parser_bench.cc 3rdparty/dmlc-core/libdmlc.a -lpthread -o parser_bench
+ *  Usage:
+ *    parser_bench [key=value ...]
+ *      rows=200000 nnz=40 dim=10000000 csv_cols=64 sparsity=0.5
+ *      threads=1,2,4 formats=libsvm,libfm,csv,rmf part=unitest/part
+ *      dir=/tmp/dmlc_parser_bench repeat=3 cache=1 batch=256 decimal=1
+ */
+#include <dmlc/data.h>
+#include <dmlc/io.h>
+#include <dmlc/logging.h>
+#include <dmlc/memory_io.h>
+#include <dmlc/timer.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "data/decimal.h"
+#include "data/row_block.h"
+
+namespace {
+// count every heap allocation of the process
+std::atomic<size_t> g_num_alloc(0);
+std::atomic<size_t> g_alloc_bytes(0);
+// keeps the consumer pass from being optimized away
+volatile double g_sink = 0;
+}  // namespace
+
+// every replaced operator new and delete goes through this one pair, kept
+// out of line so that the compiler does not pair a new expression with free
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+namespace {
+BENCH_NOINLINE void *CountedAlloc(size_t size) noexcept {
+  g_num_alloc.fetch_add(1, std::memory_order_relaxed);
+  g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+  return std::malloc(size == 0 ? 1 : size);
+}
+BENCH_NOINLINE void CountedFree(void *ptr) noexcept {
+  std::free(ptr);
+}
+}  // namespace
+
+void *operator new(size_t size) {
+  void *ptr = CountedAlloc(size);
+  if (ptr == NULL) throw std::bad_alloc();
+  return ptr;
+}
+void *operator new[](size_t size) {
+  void *ptr = CountedAlloc(size);
+  if (ptr == NULL) throw std::bad_alloc();
+  return ptr;
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return CountedAlloc(size);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return CountedAlloc(size);
+}
+void operator delete(void *ptr) noexcept {
+  CountedFree(ptr);
+}
+void operator delete[](void *ptr) noexcept {
+  CountedFree(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept {
+  CountedFree(ptr);
+}
+void operator delete[](void *ptr, size_t) noexcept {
+  CountedFree(ptr);
+}
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  CountedFree(ptr);
+}
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  CountedFree(ptr);
+}
+
+namespace {
+/*! \brief benchmark configuration, filled from key=value arguments */
+struct BenchConfig {
+  size_t rows = 200000;
+  size_t nnz = 40;
+  size_t dim = 10000000;
+  size_t csv_cols = 64;
+  double sparsity = 0.5;
+  std::vector<int> threads = {1, 2, 4};
+  std::vector<std::string> formats = {"libsvm", "libfm", "csv", "rmf"};
+  std::string part;
+  std::string dir = "/tmp/dmlc_parser_bench";
+  int repeat = 3;
+  bool cache = true;
+  size_t batch = 256;
+  bool decimal = true;
+};
+
+/*! \brief one corpus to benchmark */
+struct Corpus {
+  std::string name;
+  std::string format;
+  std::string path;
+  std::string args;
+};
+
+std::vector<std::string> Split(const std::string &str, char delim) {
+  std::vector<std::string> ret;
+  std::istringstream is(str);
+  std::string item;
+  while (std::getline(is, item, delim)) {
+    if (item.length() != 0) ret.push_back(item);
+  }
+  return ret;
+}
+
+BenchConfig ParseArgs(int argc, char *argv[]) {
+  BenchConfig cfg;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t pos = arg.find('=');
+    CHECK(pos != std::string::npos) << "expect key=value, got " << arg;
+    std::string key = arg.substr(0, pos);
+    std::string value = arg.substr(pos + 1);
+    if (key == "rows") {
+      cfg.rows = std::strtoul(value.c_str(), NULL, 10);
+    } else if (key == "nnz") {
+      cfg.nnz = std::strtoul(value.c_str(), NULL, 10);
+    } else if (key == "dim") {
+      cfg.dim = std::strtoul(value.c_str(), NULL, 10);
+    } else if (key == "csv_cols") {
+      cfg.csv_cols = std::strtoul(value.c_str(), NULL, 10);
+    } else if (key == "sparsity") {
+      cfg.sparsity = std::atof(value.c_str());
+    } else if (key == "threads") {
+      cfg.threads.clear();
+      for (const std::string &t : Split(value, ',')) cfg.threads.push_back(std::atoi(t.c_str()));
+    } else if (key == "formats") {
+      cfg.formats = Split(value, ',');
+    } else if (key == "part") {
+      cfg.part = value;
+    } else if (key == "dir") {
+      cfg.dir = value;
+    } else if (key == "repeat") {
+      cfg.repeat = std::max(std::atoi(value.c_str()), 1);
+    } else if (key == "cache") {
+      cfg.cache = value != "0";
+    } else if (key == "batch") {
+      cfg.batch = std::strtoul(value.c_str(), NULL, 10);
+    } else if (key == "decimal") {
+      cfg.decimal = value != "0";
+    } else {
+      LOG(FATAL) << "unknown argument " << key;
+    }
+  }
+  CHECK(cfg.nnz != 0 && cfg.dim != 0 && cfg.csv_cols != 0 && cfg.batch != 0 &&
+        !cfg.threads.empty());
+  return cfg;
+}
+
+/*! \brief buffered text writer of a synthetic corpus */
+class CorpusWriter {
+ public:
+  explicit CorpusWriter(const std::string &path)
+      : fo_(dmlc::Stream::Create(path.c_str(), "w")) {}
+  ~CorpusWriter(void) {
+    this->Flush();
+    delete fo_;
+  }
+  CorpusWriter &operator<<(const std::string &str) {
+    buf_ += str;
+    if (buf_.length() > (1 << 20)) this->Flush();
+    return *this;
+  }
+  CorpusWriter &operator<<(char c) {
+    buf_ += c;
+    return *this;
+  }
+  CorpusWriter &operator<<(size_t v) {
+    return *this << std::to_string(v);
+  }
+  CorpusWriter &operator<<(float v) {
+    char str[32];
+    std::snprintf(str, sizeof(str), "%.6f", v);
+    return *this << std::string(str);
+  }
+
+ private:
+  void Flush(void) {
+    if (buf_.length() != 0) fo_->Write(buf_.data(), buf_.length());
+    buf_.clear();
+  }
+  dmlc::Stream *fo_;
+  std::string buf_;
+};
+
+/*! \brief synthetic sparse rows with sorted feature ids */
+class RowGenerator {
+ public:
+  explicit RowGenerator(const BenchConfig &cfg) : cfg_(cfg), rnd_(0) {}
+  size_t Length(void) {
+    return 1 + rnd_() % (2 * cfg_.nnz);
+  }
+  void SortedIndex(size_t n, size_t dim, std::vector<size_t> *out) {
+    out->clear();
+    size_t step = std::max<size_t>(dim / (n + 1), 1);
+    size_t idx = rnd_() % step;
+    for (size_t i = 0; i < n && idx < dim; ++i) {
+      out->push_back(idx);
+      idx += 1 + rnd_() % (2 * step);
+    }
+  }
+  float Value(void) {
+    return std::uniform_real_distribution<float>(0.0f, 1.0f)(rnd_);
+  }
+  bool Zero(void) {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rnd_) < cfg_.sparsity;
+  }
+  size_t Int(size_t bound) {
+    return rnd_() % bound;
+  }
+
+ private:
+  const BenchConfig &cfg_;
+  std::mt19937_64 rnd_;
+};
+
+void WriteLibSVM(const BenchConfig &cfg, const std::string &path) {
+  CorpusWriter out(path);
+  RowGenerator gen(cfg);
+  std::vector<size_t> index;
+  for (size_t r = 0; r < cfg.rows; ++r) {
+    out << gen.Int(2);
+    gen.SortedIndex(gen.Length(), cfg.dim, &index);
+    for (size_t idx : index) out << ' ' << idx << ':' << gen.Value();
+    out << '\n';
+  }
+}
+
+void WriteLibFM(const BenchConfig &cfg, const std::string &path) {
+  CorpusWriter out(path);
+  RowGenerator gen(cfg);
+  std::vector<size_t> index;
+  for (size_t r = 0; r < cfg.rows; ++r) {
+    out << gen.Int(2);
+    gen.SortedIndex(gen.Length(), cfg.dim, &index);
+    for (size_t i = 0; i < index.size(); ++i) {
+      out << ' ' << (i * 16 / index.size()) << ':' << index[i] << ':' << gen.Value();
+    }
+    out << '\n';
+  }
+}
+
+void WriteCSV(const BenchConfig &cfg, const std::string &path) {
+  CorpusWriter out(path);
+  RowGenerator gen(cfg);
+  for (size_t r = 0; r < cfg.rows; ++r) {
+    out << gen.Int(2);
+    for (size_t c = 0; c < cfg.csv_cols; ++c) {
+      out << ',';
+      if (gen.Zero()) {
+        out << '0';
+      } else {
+        out << gen.Value();
+      }
+    }
+    out << '\n';
+  }
+}
+
+/*! \brief rmf rows shaped like unitest/part: 2 labels, 9 dense, 36 cate, 5 fields */
+void WriteRMF(const BenchConfig &cfg, const std::string &path) {
+  const size_t kDense = 9, kCate = 36, kFields = 5;
+  CorpusWriter out(path);
+  RowGenerator gen(cfg);
+  std::vector<size_t> index;
+  for (size_t r = 0; r < cfg.rows; ++r) {
+    out << gen.Value() << ' ' << gen.Int(2) << '\001';
+    for (size_t i = 0; i < kDense; ++i) {
+      if (i != 0) out << ' ';
+      if (gen.Zero()) {
+        out << std::string("0.000000");
+      } else {
+        out << gen.Value();
+      }
+    }
+    out << '\001';
+    for (size_t i = 0; i < kCate; ++i) {
+      if (i != 0) out << ' ';
+      out << gen.Int(i < 2 ? cfg.dim : 1000);
+    }
+    out << '\001';
+    for (size_t f = 0; f < kFields; ++f) {
+      if (f != 0) out << ' ';
+      gen.SortedIndex(1 + gen.Int(cfg.nnz), 100000, &index);
+      for (size_t i = 0; i < index.size(); ++i) {
+        if (i != 0) out << ',';
+        out << index[i];
+      }
+    }
+    out << '\001';
+    gen.SortedIndex(gen.Length(), cfg.dim, &index);
+    for (size_t i = 0; i < index.size(); ++i) {
+      if (i != 0) out << ' ';
+      out << index[i];
+    }
+    out << '\n';
+  }
+}
+
+std::vector<Corpus> PrepareCorpora(const BenchConfig &cfg) {
+  std::vector<Corpus> ret;
+  int ret_mkdir = std::system(("mkdir -p " + cfg.dir).c_str());
+  CHECK_EQ(ret_mkdir, 0) << "cannot create " << cfg.dir;
+  for (const std::string &format : cfg.formats) {
+    Corpus c;
+    c.name = "synthetic";
+    c.format = format;
+    c.path = cfg.dir + "/synthetic." + format;
+    double start = dmlc::GetTime();
+    if (format == "libsvm") {
+      WriteLibSVM(cfg, c.path);
+    } else if (format == "libfm") {
+      WriteLibFM(cfg, c.path);
+    } else if (format == "csv") {
+      WriteCSV(cfg, c.path);
+      c.args = "label_column=0";
+    } else if (format == "rmf") {
+      WriteRMF(cfg, c.path);
+      c.args = "multi_field_num=5&label_width=2";
+    } else {
+      LOG(FATAL) << "no generator for format " << format;
+    }
+    std::printf("generated %s in %.2f sec\n", c.path.c_str(), dmlc::GetTime() - start);
+    ret.push_back(c);
+  }
+  if (cfg.part.length() != 0) {
+    Corpus c;
+    c.name = "part";
+    c.format = "rmf";
+    c.path = cfg.part;
+    c.args = "multi_field_num=5&label_width=2";
+    ret.push_back(c);
+  }
+  return ret;
+}
+
+std::string MakeURI(const Corpus &c, int nthread) {
+  std::string uri = c.path + "?nthread=" + std::to_string(nthread);
+  if (c.args.length() != 0) uri += "&" + c.args;
+  return uri;
+}
+
+/*! \brief result of one stage, the best of all repeats is kept */
+struct StageResult {
+  double sec = 0;
+  size_t bytes = 0;
+  size_t rows = 0;
+  size_t num_alloc = 0;
+  size_t alloc_bytes = 0;
+  /*! \brief bytes written by the stage, if it compresses */
+  size_t out_bytes = 0;
+  void Keep(const StageResult &other) {
+    if (sec == 0 || other.sec < sec) *this = other;
+  }
+};
+
+/*! \brief measure the allocations and wall time between construction and Stop */
+class StageTimer {
+ public:
+  StageTimer(void)
+      : num_alloc_(g_num_alloc.load()), alloc_bytes_(g_alloc_bytes.load()),
+        start_(dmlc::GetTime()) {}
+  void Stop(StageResult *res) const {
+    res->sec = dmlc::GetTime() - start_;
+    res->num_alloc = g_num_alloc.load() - num_alloc_;
+    res->alloc_bytes = g_alloc_bytes.load() - alloc_bytes_;
+  }
+
+ private:
+  size_t num_alloc_, alloc_bytes_;
+  double start_;
+};
+
+StageResult RunRead(const Corpus &c) {
+  StageResult res;
+  StageTimer timer;
+  dmlc::InputSplit *source = dmlc::InputSplit::Create(c.path.c_str(), 0, 1, "text");
+  dmlc::InputSplit::Blob chunk;
+  while (source->NextChunk(&chunk)) res.bytes += chunk.size;
+  delete source;
+  timer.Stop(&res);
+  return res;
+}
+
+StageResult RunParse(const Corpus &c, int nthread, StageResult *touch) {
+  StageResult res;
+  double touch_sec = 0;
+  double checksum = 0;
+  size_t touch_alloc = 0, touch_alloc_bytes = 0;
+  StageTimer timer;
+  dmlc::Parser<uint32_t> *parser =
+      dmlc::Parser<uint32_t>::Create(MakeURI(c, nthread).c_str(), 0, 1, c.format.c_str());
+  while (parser->Next()) {
+    const dmlc::RowBlock<uint32_t> &block = parser->Value();
+    res.rows += block.size;
+    // consumer side, visit every entry of the block once
+    double start = dmlc::GetTime();
+    size_t num_alloc = g_num_alloc.load(), alloc_bytes = g_alloc_bytes.load();
+    for (size_t i = 0; i < block.size; ++i) {
+      dmlc::Row<uint32_t> row = block[i];
+      for (size_t j = 0; j < row.length; ++j) checksum += row.get_index(j);
+      for (size_t k = 0; k < row.extra.size(); ++k) {
+        for (size_t j = 0; j < row.extra[k].length; ++j) {
+          checksum += row.extra[k].get_index(j) + row.extra[k].get_value(j);
+        }
+      }
+    }
+    touch_sec += dmlc::GetTime() - start;
+    touch_alloc += g_num_alloc.load() - num_alloc;
+    touch_alloc_bytes += g_alloc_bytes.load() - alloc_bytes;
+  }
+  res.bytes = parser->BytesRead();
+  delete parser;
+  timer.Stop(&res);
+  res.sec -= touch_sec;
+  res.num_alloc -= touch_alloc;
+  res.alloc_bytes -= touch_alloc_bytes;
+  touch->sec = touch_sec;
+  touch->rows = res.rows;
+  touch->num_alloc = touch_alloc;
+  touch->alloc_bytes = touch_alloc_bytes;
+  g_sink = checksum;
+  return res;
+}
+
+StageResult RunCache(const Corpus &c, const BenchConfig &cfg, int nthread, int epoch) {
+  std::string cache_file = cfg.dir + "/" + c.name + "." + c.format + ".cache";
+  if (epoch == 0) std::remove(cache_file.c_str());
+  StageResult res;
+  StageTimer timer;
+  dmlc::RowBlockIter<uint32_t> *iter = dmlc::RowBlockIter<uint32_t>::Create(
+      (MakeURI(c, nthread) + "#" + cache_file).c_str(), 0, 1, c.format.c_str());
+  while (iter->Next()) res.rows += iter->Value().size;
+  delete iter;
+  timer.Stop(&res);
+  return res;
+}
+
+/*!
+ * \brief most heap allocations per block of a warm parser. Chunk reading
+ *  and the parse threads allocate per chunk, a record must not allocate.
+ */
+const size_t kMaxSteadyAllocPerBlock = 4;
+
+StageResult RunSteady(const Corpus &c, int nthread) {
+  StageResult res;
+  dmlc::Parser<uint32_t> *parser =
+      dmlc::Parser<uint32_t>::Create(MakeURI(c, nthread).c_str(), 0, 1, c.format.c_str());
+  // warm up, every buffer grows to the largest block of its thread
+  while (parser->Next()) {}
+  parser->BeforeFirst();
+  size_t nblock = 0;
+  StageTimer timer;
+  while (parser->Next()) {
+    res.rows += parser->Value().size;
+    ++nblock;
+  }
+  timer.Stop(&res);
+  delete parser;
+  CHECK_LE(res.num_alloc, kMaxSteadyAllocPerBlock * nblock)
+      << c.format << " parser allocates per record once warm: "
+      << res.num_alloc << " allocations for " << nblock << " blocks of "
+      << res.rows << " rows";
+  return res;
+}
+
+/*! \brief check that row i of a slice is row begin + i of the block */
+void CheckSlice(const dmlc::RowBlock<uint32_t> &block, size_t begin,
+                const dmlc::RowBlock<uint32_t> &slice) {
+  for (size_t i = 0; i < slice.size; ++i) {
+    dmlc::Row<uint32_t> a = block[begin + i], b = slice[i];
+    CHECK(a.label == b.label && a.length == b.length && a.index == b.index &&
+          a.value == b.value && a.label_width == b.label_width &&
+          a.extra.size() == b.extra.size()) << "slice does not match its block";
+    for (size_t k = 0; k < a.extra.size(); ++k) {
+      dmlc::UnitData<uint32_t> ua = a.extra[k], ub = b.extra[k];
+      CHECK(ua.length == ub.length && ua.index == ub.index && ua.value == ub.value)
+          << "extra section " << k << " of slice does not match its block";
+    }
+  }
+}
+
+StageResult RunSlice(const Corpus &c, const BenchConfig &cfg, bool check) {
+  StageResult res;
+  double slice_sec = 0;
+  size_t num_alloc = 0, alloc_bytes = 0;
+  double checksum = 0;
+  dmlc::RowBlock<uint32_t> minibatch;
+  dmlc::Parser<uint32_t> *parser = dmlc::Parser<uint32_t>::Create(
+      MakeURI(c, cfg.threads.back()).c_str(), 0, 1, c.format.c_str());
+  while (parser->Next()) {
+    const dmlc::RowBlock<uint32_t> &block = parser->Value();
+    StageTimer timer;
+    for (size_t begin = 0; begin < block.size; begin += cfg.batch) {
+      block.Slice(begin, std::min(begin + cfg.batch, block.size), &minibatch);
+      res.rows += minibatch.size;
+      checksum += minibatch.offset[minibatch.size] - minibatch.offset[0];
+      for (size_t k = 0; k < minibatch.extra.size(); ++k) {
+        checksum += minibatch.extra[k][0].length;
+      }
+    }
+    StageResult t;
+    timer.Stop(&t);
+    slice_sec += t.sec;
+    num_alloc += t.num_alloc;
+    alloc_bytes += t.alloc_bytes;
+    for (size_t begin = 0; check && begin < block.size; begin += cfg.batch) {
+      block.Slice(begin, std::min(begin + cfg.batch, block.size), &minibatch);
+      CheckSlice(block, begin, minibatch);
+    }
+  }
+  delete parser;
+  g_sink = checksum;
+  res.sec = slice_sec;
+  res.num_alloc = num_alloc;
+  res.alloc_bytes = alloc_bytes;
+  return res;
+}
+
+/*! \brief parse the whole corpus into memory */
+void LoadBlocks(const Corpus &c, const BenchConfig &cfg,
+                std::vector<dmlc::data::RowBlockContainer<uint32_t> > *blocks) {
+  dmlc::Parser<uint32_t> *parser = dmlc::Parser<uint32_t>::Create(
+      MakeURI(c, cfg.threads.back()).c_str(), 0, 1, c.format.c_str());
+  while (parser->Next()) {
+    blocks->emplace_back();
+    blocks->back().Push(parser->Value());
+  }
+  delete parser;
+}
+
+template<typename IndexType>
+StageResult RunAppend(const std::vector<dmlc::data::RowBlockContainer<uint32_t> > &blocks) {
+  StageResult res;
+  dmlc::data::RowBlockContainer<IndexType> data;
+  // grow the arrays first, so that the copy loops are timed, not the page faults
+  for (const auto &block : blocks) data.Push(block.GetBlock());
+  data.Clear();
+  StageTimer timer;
+  for (const auto &block : blocks) {
+    data.Push(block.GetBlock());
+    res.bytes += block.MemCostBytes();
+  }
+  timer.Stop(&res);
+  res.rows = data.Size();
+  g_sink = static_cast<double>(data.max_index);
+  return res;
+}
+
+/*! \brief whether the arrays of two containers are equal */
+bool SameBlock(const dmlc::data::RowBlockContainer<uint32_t> &a,
+               const dmlc::data::RowBlockContainer<uint32_t> &b) {
+  if (a.extra.size() != b.extra.size()) return false;
+  for (size_t k = 0; k < a.extra.size(); ++k) {
+    const auto &x = a.extra[k], &y = b.extra[k];
+    if (x.offset != y.offset || x.index != y.index || x.index16 != y.index16 ||
+        x.index32 != y.index32 || x.value != y.value || x.length != y.length) {
+      return false;
+    }
+  }
+  return a.offset == b.offset && a.label == b.label && a.weight == b.weight &&
+      a.qid == b.qid && a.field == b.field && a.field8 == b.field8 &&
+      a.field16 == b.field16 && a.index == b.index && a.index16 == b.index16 &&
+      a.index32 == b.index32 && a.value == b.value &&
+      a.label_width == b.label_width && a.max_index == b.max_index &&
+      a.max_field == b.max_field;
+}
+
+/*! \brief save the blocks with codec level into memory, then load them back */
+void RunCodec(const std::vector<dmlc::data::RowBlockContainer<uint32_t> > &blocks,
+              int level, bool check, StageResult *encode, StageResult *decode) {
+  std::string buf;
+  dmlc::MemoryStringStream fo(&buf);
+  // one encoder for every block, as BuildRowBlockCache
+  dmlc::data::codec::ArrayEncoder encoder(level);
+  StageTimer etimer;
+  for (const auto &block : blocks) {
+    block.Save(&fo, &encoder);
+    encode->bytes += block.MemCostBytes();
+    encode->rows += block.Size();
+  }
+  etimer.Stop(encode);
+  encode->out_bytes = buf.length();
+  dmlc::MemoryStringStream fi(&buf);
+  dmlc::data::RowBlockContainer<uint32_t> data;
+  size_t i = 0;
+  StageTimer dtimer;
+  while (data.Load(&fi)) {
+    decode->bytes += data.MemCostBytes();
+    decode->rows += data.Size();
+    if (check) CHECK(SameBlock(blocks[i], data)) << "codec level " << level << " block " << i;
+    ++i;
+  }
+  dtimer.Stop(decode);
+  CHECK_EQ(i, blocks.size());
+  decode->out_bytes = buf.length();
+}
+
+/*! \brief float tokens covering the fast path, the slow path and malformed input */
+std::vector<std::string> FloatTokens(size_t n_random) {
+  std::vector<std::string> ret = {
+    "", "+", "-", ".", "-.", "e5", ".e1", "0", "-0", "+0.0", "0.5", "-.5", "+.5e1",
+    "1e", "1e+", "1e-", "1.5x", "1.5e3.2", "12,5", "0x1p3", "-0X1.8P-2", "inf",
+    "-Infinity", "nan", "NAN(123)", "1e-50", "1e39", "-1e39", "3.4028235e38",
+    "3.4028236e38", "1.17549435e-38", "1.4e-45", "7e-46", "16777216", "16777217",
+    "16777218.5", "0.000000000000000000000000000000000000000000001",
+    "00000000000000000000001.5", "1.00000000000000000000000000000001",
+    "99999999999999999999", "18446744073709551615", "0.1e-10", "12345678e-10",
+    "1234567e10", "1e0010", "1E+10", "123456789012345678901234567890e-20"};
+  char buf[128];
+  std::mt19937_64 rnd(1);
+  // decimal exponent sweep, positional and scientific
+  for (int digits = 1; digits <= 10; ++digits) {
+    for (int exp = -50; exp <= 50; ++exp) {
+      uint64_t m = rnd() % dmlc::data::decimal::kPow10Int[std::min(digits, 8)] + 1;
+      std::snprintf(buf, sizeof(buf), "%llue%d", static_cast<unsigned long long>(m), exp);
+      ret.push_back(buf);
+      std::snprintf(buf, sizeof(buf), "%.*f", std::max(-exp, 0), m * std::pow(10.0, exp));
+      if (std::strlen(buf) < 64) ret.push_back(buf);
+    }
+  }
+  // long mantissas, beyond the 19 digits of the fast path
+  for (int i = 0; i < 2000; ++i) {
+    std::string str = (rnd() % 2) ? "-" : "";
+    size_t len = 1 + rnd() % 40, point = rnd() % (len + 1);
+    for (size_t k = 0; k < len; ++k) {
+      if (k == point) str += '.';
+      str += static_cast<char>('0' + rnd() % 10);
+    }
+    ret.push_back(str);
+  }
+  // random floats printed with every precision, hits rounding boundaries
+  for (size_t i = 0; i < n_random; ++i) {
+    uint32_t bits = static_cast<uint32_t>(rnd());
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    if (!std::isfinite(f)) continue;
+    const char *fmt[] = {"%.9g", "%.7g", "%.6g", "%.3g", "%.12e", "%.6f"};
+    for (const char *ft : fmt) {
+      std::snprintf(buf, sizeof(buf), ft, f);
+      ret.push_back(buf);
+    }
+  }
+  return ret;
+}
+
+/*! \brief check ParseDecimalFloat and ParseDecimalUInt against strtof and strtoull */
+void CheckDecimal(const std::vector<std::string> &tokens) {
+  for (const std::string &t : tokens) {
+    float expect = std::strtof(t.c_str(), NULL);
+    float got = dmlc::data::ParseDecimalFloat(t.data(), t.data() + t.length());
+    uint32_t a, b;
+    std::memcpy(&a, &expect, sizeof(a));
+    std::memcpy(&b, &got, sizeof(b));
+    CHECK(a == b || (std::isnan(expect) && std::isnan(got)))
+        << "ParseDecimalFloat(\"" << t << "\") = " << got << ", strtof gives " << expect;
+  }
+  std::mt19937_64 rnd(2);
+  std::vector<std::string> ints = {"", "+", "x", "0", "+0", "007", "12ab",
+      "4294967295", "4294967296", "18446744073709551615", "18446744073709551616",
+      "99999999999999999999999"};
+  for (int i = 0; i < 100000; ++i) {
+    std::string str = (rnd() % 8 == 0) ? "+" : "";
+    str += std::to_string(rnd() >> (rnd() % 64));
+    ints.push_back(str);
+  }
+  for (const std::string &t : ints) {
+    char *end;
+    errno = 0;
+    unsigned long long expect = std::strtoull(t.c_str(), &end, 10);
+    bool valid = end != t.c_str() && errno != ERANGE;
+    uint64_t got64 = 0;
+    uint32_t got32 = 0;
+    CHECK_EQ(dmlc::data::ParseDecimalUInt(t.data(), t.data() + t.length(), &got64), valid)
+        << "ParseDecimalUInt<uint64_t>(\"" << t << "\")";
+    CHECK(!valid || got64 == expect) << "ParseDecimalUInt<uint64_t>(\"" << t << "\")";
+    bool valid32 = valid && expect <= 0xffffffffULL;
+    CHECK_EQ(dmlc::data::ParseDecimalUInt(t.data(), t.data() + t.length(), &got32), valid32)
+        << "ParseDecimalUInt<uint32_t>(\"" << t << "\")";
+    CHECK(!valid32 || got32 == expect) << "ParseDecimalUInt<uint32_t>(\"" << t << "\")";
+  }
+}
+
+/*! \brief decode every token of the packed text, fast with decimal.h, else the C library */
+StageResult RunDecimal(const std::string &text, const std::vector<size_t> &offset,
+                       bool is_float, bool fast) {
+  StageResult res;
+  double checksum = 0;
+  StageTimer timer;
+  for (size_t i = 0; i + 1 < offset.size(); ++i) {
+    const char *b = text.data() + offset[i], *e = text.data() + offset[i + 1] - 1;
+    if (is_float) {
+      checksum += fast ? dmlc::data::ParseDecimalFloat(b, e) : std::strtof(b, NULL);
+    } else {
+      uint64_t v = 0;
+      if (fast) {
+        dmlc::data::ParseDecimalUInt(b, e, &v);
+      } else {
+        v = std::strtoull(b, NULL, 10);
+      }
+      checksum += static_cast<double>(v);
+    }
+  }
+  timer.Stop(&res);
+  res.bytes = text.length();
+  res.rows = offset.size() - 1;
+  g_sink = checksum;
+  return res;
+}
+
+/*! \brief tokens shaped like the parsed corpora, '\0' terminated so that strtof can read them */
+void DecimalCorpus(bool is_float, std::string *text, std::vector<size_t> *offset) {
+  std::mt19937_64 rnd(3);
+  char buf[32];
+  offset->assign(1, 0);
+  for (size_t i = 0; i < (1 << 20); ++i) {
+    if (is_float) {
+      std::snprintf(buf, sizeof(buf), "%.6f",
+                    std::uniform_real_distribution<float>(0.0f, 1.0f)(rnd));
+    } else {
+      std::snprintf(buf, sizeof(buf), "%llu",
+                    static_cast<unsigned long long>(rnd() % 10000000));
+    }
+    text->append(buf);
+    text->push_back('\0');
+    offset->push_back(text->length());
+  }
+}
+
+void Report(const char *stage, const Corpus &c, int nthread, const StageResult &res) {
+  double mb = res.bytes / 1024.0 / 1024.0;
+  std::printf("%-8s %-9s %-7s %3d thr %8.3f sec", stage, c.name.c_str(),
+              c.format.c_str(), nthread, res.sec);
+  if (res.bytes != 0) std::printf(" %9.1f MB/s", mb / res.sec);
+  if (res.out_bytes != 0) {
+    std::printf(" %6.2fx ratio", static_cast<double>(res.bytes) / res.out_bytes);
+  }
+  if (res.rows != 0) std::printf(" %10.0f rows/s", res.rows / res.sec);
+  if (res.num_alloc != 0) {
+    std::printf(" %9zu allocs %8.1f MB alloc", res.num_alloc,
+                res.alloc_bytes / 1024.0 / 1024.0);
+    if (res.rows != 0) std::printf(" %8.4f allocs/row", static_cast<double>(res.num_alloc) / res.rows);
+  }
+  std::printf("\n");
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  BenchConfig cfg = ParseArgs(argc, argv);
+  if (cfg.decimal) {
+    CheckDecimal(FloatTokens(100000));
+    for (int is_float = 1; is_float >= 0; --is_float) {
+      Corpus c;
+      c.name = "tokens";
+      c.format = is_float ? "float" : "uint";
+      std::string text;
+      std::vector<size_t> offset;
+      DecimalCorpus(is_float != 0, &text, &offset);
+      StageResult libc, fast;
+      for (int r = 0; r < cfg.repeat; ++r) {
+        libc.Keep(RunDecimal(text, offset, is_float != 0, false));
+        fast.Keep(RunDecimal(text, offset, is_float != 0, true));
+      }
+      Report(is_float ? "strtof" : "strtoull", c, 1, libc);
+      Report(is_float ? "decimal" : "uint", c, 1, fast);
+    }
+  }
+  std::vector<Corpus> corpora = PrepareCorpora(cfg);
+  for (const Corpus &c : corpora) {
+    StageResult read;
+    for (int r = 0; r < cfg.repeat; ++r) read.Keep(RunRead(c));
+    Report("read", c, 1, read);
+    for (int nthread : cfg.threads) {
+      StageResult parse, touch;
+      for (int r = 0; r < cfg.repeat; ++r) {
+        StageResult t;
+        parse.Keep(RunParse(c, nthread, &t));
+        touch.Keep(t);
+      }
+      Report("parse", c, nthread, parse);
+      Report("touch", c, nthread, touch);
+      Report("steady", c, nthread, RunSteady(c, nthread));
+    }
+    StageResult slice;
+    for (int r = 0; r < cfg.repeat; ++r) slice.Keep(RunSlice(c, cfg, r == 0));
+    Report("slice", c, cfg.threads.back(), slice);
+    std::vector<dmlc::data::RowBlockContainer<uint32_t> > blocks;
+    LoadBlocks(c, cfg, &blocks);
+    StageResult append, widen;
+    for (int r = 0; r < cfg.repeat; ++r) {
+      append.Keep(RunAppend<uint32_t>(blocks));
+      widen.Keep(RunAppend<uint64_t>(blocks));
+    }
+    Report("append", c, 1, append);
+    Report("widen", c, 1, widen);
+    for (int level = 0; level <= dmlc::data::codec::kMaxLevel; ++level) {
+      StageResult encode, decode;
+      for (int r = 0; r < cfg.repeat; ++r) {
+        StageResult e, d;
+        RunCodec(blocks, level, r == 0, &e, &d);
+        encode.Keep(e);
+        decode.Keep(d);
+      }
+      std::string name = std::to_string(level);
+      Report(("encode" + name).c_str(), c, 1, encode);
+      Report(("decode" + name).c_str(), c, 1, decode);
+    }
+    blocks.clear();
+    if (cfg.cache) {
+      int nthread = cfg.threads.back();
+      StageResult build = RunCache(c, cfg, nthread, 0), replay;
+      for (int r = 0; r < cfg.repeat; ++r) replay.Keep(RunCache(c, cfg, nthread, r + 1));
+      Report("build", c, nthread, build);
+      Report("replay", c, nthread, replay);
+    }
+  }
+  return 0;
+}
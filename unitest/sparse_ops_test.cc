@@ -0,0 +1,210 @@
+/*!
+ *  Copyright (c) 2020 by Contributors
+ * \file sparse_ops_test.cc
+ * \brief checks the RowBlock kernels of dmlc/sparse_ops.h against
+ *  reference implementations, for every index storage, with and without
+ *  values and weights, and for several thread counts:
+ *    SpMV           against Row::SDot of every row
+ *    SpMVTranspose  against a scalar loop over the entries in row order
+ *    FFMScore       against a naive double precision loop over the entry pairs
+ *    FFMGradient    the same, for every field storage
+ *
+ *  Build against dmlc-core, e.g.
+ *    g++ -std=c++11 -O3 -march=native -fopenmp -I3rdparty/dmlc-core/include \
+ *        unitest/sparse_ops_test.cc 3rdparty/dmlc-core/libdmlc.a -lpthread -o sparse_ops_test
+ *  Usage:
+ *    sparse_ops_test
+ *  prints one line per case and exits with 1 if any case fails.
+ */
+#include <dmlc/sparse_ops.h>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+/*! \brief a random block of 32 bit indices below dim and its narrow copies */
+struct TestBlock {
+  std::vector<size_t> offset;
+  std::vector<float> label, value;
+  std::vector<dmlc::real_t> weight;
+  std::vector<uint32_t> index, field;
+  std::vector<uint16_t> index16;
+  std::vector<uint8_t> field8;
+  TestBlock(size_t nrow, size_t max_nnz, size_t dim, unsigned seed, size_t num_field = 8) {
+    std::mt19937 rng(seed);
+    offset.push_back(0);
+    for (size_t i = 0; i < nrow; ++i) {
+      // every 64th row is long, so that the rows are skewed
+      const size_t n = i % 64 == 0 ? max_nnz * 16 : rng() % max_nnz;
+      for (size_t j = 0; j < n; ++j) {
+        // half of the entries hit the first 64 columns, the rest is uniform
+        index.push_back(rng() % 2 == 0 ? rng() % std::min<size_t>(dim, 64) : rng() % dim);
+        value.push_back(static_cast<float>(rng() % 2000) / 1000.0f - 1.0f);
+        field.push_back(rng() % num_field);
+      }
+      offset.push_back(index.size());
+      label.push_back(static_cast<float>(i % 2));
+      weight.push_back(0.5f + static_cast<float>(i % 3));
+    }
+    if (dim <= 65536) index16.assign(index.begin(), index.end());
+    field8.assign(field.begin(), field.end());
+  }
+  /*!
+   * \return the block, indices in storage 0: index, 1: index32, 2: index16,
+   *  fields in field_storage 0: none, 1: field, 2: field8
+   */
+  dmlc::RowBlock<uint32_t> Get(int storage, bool has_value, int field_storage = 0) const {
+    dmlc::RowBlock<uint32_t> b;
+    b.size = label.size();
+    b.offset = offset.data();
+    b.label = label.data();
+    b.weight = weight.data();
+    b.qid = NULL;
+    b.field = field_storage == 1 ? field.data() : NULL;
+    b.field8 = field_storage == 2 ? field8.data() : NULL;
+    b.index = storage == 0 ? index.data() : NULL;
+    b.index32 = storage == 1 ? index.data() : NULL;
+    b.index16 = storage == 2 ? index16.data() : NULL;
+    b.value = has_value ? value.data() : NULL;
+    return b;
+  }
+};
+
+/*! \brief whether got is within a relative float rounding of ref, of scale */
+inline bool Close(double got, double ref, double scale) {
+  return std::fabs(got - ref) <= 1e-5 * (1.0 + scale);
+}
+
+/*! \return number of failed SpMV and SpMVTranspose cases of the block */
+int CheckLinear(const TestBlock &data, size_t dim) {
+  int failed = 0;
+  std::mt19937 rng(7);
+  std::vector<float> x(dim), y(data.label.size());
+  for (size_t k = 0; k < dim; ++k) x[k] = static_cast<float>(rng() % 2000) / 1000.0f - 1.0f;
+  for (size_t i = 0; i < y.size(); ++i) y[i] = static_cast<float>(i % 7) - 3.0f;
+  for (int storage = 0; storage < 3; ++storage) {
+    if (storage == 2 && data.index16.empty()) continue;
+    for (int has_value = 0; has_value < 2; ++has_value) {
+      for (int weighted = 0; weighted < 2; ++weighted) {
+        const dmlc::RowBlock<uint32_t> b = data.Get(storage, has_value != 0);
+        // references, one thread in row order
+        std::vector<double> tref(dim, 0.0), tscale(dim, 0.0);
+        for (size_t i = 0; i < b.size; ++i) {
+          const dmlc::Row<uint32_t> row = b[i];
+          const double xi = weighted ? y[i] * b.weight[i] : y[i];
+          for (size_t j = 0; j < row.length; ++j) {
+            const double v = xi * (has_value ? row.get_value(j) : 1.0f);
+            tref[row.get_index(j)] += v;
+            tscale[row.get_index(j)] += std::fabs(v);
+          }
+        }
+        std::vector<float> first;
+        for (int nthread : {1, 2, 4, 7}) {
+          bool ok = true;
+          std::vector<float> out(b.size);
+          dmlc::SpMV(b, x.data(), dim, out.data(), weighted != 0, nthread);
+          for (size_t i = 0; i < b.size && ok; ++i) {
+            const dmlc::Row<uint32_t> row = b[i];
+            double ref = row.SDot(x.data(), dim), scale = 0.0;
+            for (size_t j = 0; j < row.length; ++j) {
+              scale += std::fabs(x[row.get_index(j)] * row.get_value(j));
+            }
+            if (weighted) {
+              ref *= b.weight[i];
+              scale *= b.weight[i];
+            }
+            ok = Close(out[i], ref, scale);
+          }
+          std::vector<float> grad(dim, 0.0f);
+          dmlc::SpMVTranspose(b, y.data(), dim, grad.data(), weighted != 0, nthread);
+          for (size_t k = 0; k < dim && ok; ++k) ok = Close(grad[k], tref[k], tscale[k]);
+          // the transposed product sums in row order for any number of threads
+          if (first.empty()) first = grad;
+          ok = ok && first == grad;
+          std::printf("%-14s storage=%d value=%d weighted=%d nthread=%d %s\n",
+                      "spmv", storage, has_value, weighted, nthread, ok ? "ok" : "FAILED");
+          failed += ok ? 0 : 1;
+        }
+      }
+    }
+  }
+  return failed;
+}
+
+/*! \return number of failed FFMScore and FFMGradient cases of the block */
+int CheckFFM(const TestBlock &data, size_t dim, size_t num_field, size_t k) {
+  int failed = 0;
+  std::mt19937 rng(11);
+  const size_t stride = num_field * k;
+  std::vector<float> latent(dim * stride), coeff(data.label.size());
+  for (size_t d = 0; d < latent.size(); ++d) {
+    latent[d] = static_cast<float>(rng() % 2000) / 1000.0f - 1.0f;
+  }
+  // some rows have no loss gradient
+  for (size_t i = 0; i < coeff.size(); ++i) coeff[i] = static_cast<float>(i % 5) - 2.0f;
+  for (int storage = 0; storage < 3; ++storage) {
+    if (storage == 2 && data.index16.empty()) continue;
+    for (int field_storage = 1; field_storage < 3; ++field_storage) {
+      for (int has_value = 0; has_value < 2; ++has_value) {
+        const dmlc::RowBlock<uint32_t> b = data.Get(storage, has_value != 0, field_storage);
+        const int weighted = has_value;
+        // references, every pair a < b of every row in double precision
+        std::vector<double> sref(b.size, 0.0), sscale(b.size, 0.0);
+        std::vector<double> gref(latent.size(), 0.0), gscale(latent.size(), 0.0);
+        for (size_t i = 0; i < b.size; ++i) {
+          const dmlc::Row<uint32_t> row = b[i];
+          const double c = weighted ? coeff[i] * b.weight[i] : coeff[i];
+          for (size_t x = 0; x < row.length; ++x) {
+            for (size_t y = x + 1; y < row.length; ++y) {
+              const size_t wx = row.get_index(x) * stride + row.get_field(y) * k;
+              const size_t wy = row.get_index(y) * stride + row.get_field(x) * k;
+              const double v = static_cast<double>(row.get_value(x)) * row.get_value(y);
+              for (size_t d = 0; d < k; ++d) {
+                sref[i] += v * latent[wx + d] * latent[wy + d];
+                sscale[i] += std::fabs(v * latent[wx + d] * latent[wy + d]);
+                gref[wx + d] += c * v * latent[wy + d];
+                gref[wy + d] += c * v * latent[wx + d];
+                gscale[wx + d] += std::fabs(c * v * latent[wy + d]);
+                gscale[wy + d] += std::fabs(c * v * latent[wx + d]);
+              }
+            }
+          }
+        }
+        std::vector<float> first;
+        for (int nthread : {1, 2, 4, 7}) {
+          bool ok = true;
+          std::vector<float> score(b.size);
+          dmlc::FFMScore(b, latent.data(), dim, num_field, k, score.data(), nthread);
+          for (size_t i = 0; i < b.size && ok; ++i) ok = Close(score[i], sref[i], sscale[i]);
+          std::vector<float> grad(latent.size(), 0.0f);
+          dmlc::FFMGradient(b, latent.data(), dim, num_field, k, coeff.data(), grad.data(),
+                            weighted != 0, nthread);
+          for (size_t d = 0; d < grad.size() && ok; ++d) ok = Close(grad[d], gref[d], gscale[d]);
+          // the gradient sums in row order for any number of threads
+          if (first.empty()) first = grad;
+          ok = ok && first == grad;
+          std::printf("%-14s storage=%d field=%d value=%d weighted=%d nthread=%d %s\n",
+                      "ffm", storage, field_storage, has_value, weighted, nthread,
+                      ok ? "ok" : "FAILED");
+          failed += ok ? 0 : 1;
+        }
+      }
+    }
+  }
+  return failed;
+}
+}  // namespace
+
+int main(void) {
+  int failed = 0;
+  // enough entries that the kernels use several threads
+  failed += CheckLinear(TestBlock(30000, 40, 1 << 20, 1), 1 << 20);
+  failed += CheckLinear(TestBlock(30000, 40, 5000, 2), 5000);
+  failed += CheckLinear(TestBlock(100, 40, 300, 3), 300);
+  failed += CheckFFM(TestBlock(3000, 12, 20000, 4, 8), 20000, 8, 4);
+  failed += CheckFFM(TestBlock(3000, 12, 500, 5, 3), 500, 3, 9);
+  failed += CheckFFM(TestBlock(50, 12, 100, 6, 4), 100, 4, 4);
+  std::printf("%d failed\n", failed);
+  return failed == 0 ? 0 : 1;
+}